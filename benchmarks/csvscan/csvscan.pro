@@ -0,0 +1,19 @@
+QT = core
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+# CSV分词微基准：对比 QTextStream + QString::split 与结构字符扫描器
+TARGET = csvscan_bench
+INCLUDEPATH += ../..
+
+SOURCES += \
+        main.cpp \
+        ../../csvfile.cpp \
+        ../../csvnumber.cpp \
+        ../../csvscanner.cpp
+
+HEADERS += \
+    ../../csvfile.h \
+    ../../csvnumber.h \
+    ../../csvscanner.h
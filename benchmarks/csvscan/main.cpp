@@ -0,0 +1,175 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include "csvfile.h"
+#include "csvscanner.h"
+
+// 用法：csvscan_bench [-r 重复次数] file1.csv [file2.csv ...]
+// 每个文件依次测量：
+//   split    —— 原 loadCSV 路径：QTextStream::readLine + QString::split(',')
+//   scan-*   —— 仅结构字符扫描（各指令集内核）
+//   reader-* —— CsvReader 完整切分行和字段（各指令集内核）
+//   number-qt / number-fast —— 对所有字段做数值转换：QString::trimmed().toDouble() 与 CsvNumber
+
+struct BenchResult {
+    qint64 rows = 0;
+    qint64 fields = 0;
+    qint64 nsecs = 0;
+};
+
+static BenchResult runSplit(const QString& filePath)
+{
+    BenchResult result;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return result;
+
+    QElapsedTimer timer;
+    timer.start();
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QStringList parts = in.readLine().split(',');
+        result.rows++;
+        result.fields += parts.size();
+    }
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+static BenchResult runScan(const CsvFile& csv, CsvScanner::Kernel kernel)
+{
+    BenchResult result;
+    CsvScanner scanner(kernel);
+    const int blockSize = 1 << 20;
+    QVector<quint32> index(blockSize);
+
+    QElapsedTimer timer;
+    timer.start();
+    bool inQuotes = false;
+    for (qint64 pos = csv.startOffset(); pos < csv.size(); pos += blockSize) {
+        int length = int(qMin<qint64>(blockSize, csv.size() - pos));
+        result.fields += scanner.scan(csv.data() + pos, length, index.data(), inQuotes);
+    }
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+static BenchResult runReader(const CsvFile& csv, CsvScanner::Kernel kernel)
+{
+    BenchResult result;
+    CsvReader reader(csv, kernel);
+    CsvField line;
+    QVector<CsvField> fields;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (reader.readRow(line, fields)) {
+        result.rows++;
+        result.fields += fields.size();
+    }
+    result.nsecs = timer.nsecsElapsed();
+    return result;
+}
+
+// fast 为 false 时按原 loadCSV 的方式把字段转成 QString 再转换
+static BenchResult runNumbers(const CsvFile& csv, bool fast)
+{
+    BenchResult result;
+    CsvReader reader(csv);
+    CsvField line;
+    QVector<CsvField> fields;
+
+    QElapsedTimer timer;
+    timer.start();
+    double sum = 0.0;
+    while (reader.readRow(line, fields)) {
+        result.rows++;
+        for (const CsvField& field : fields) {
+            bool ok;
+            double value = fast ? CsvFile::toDouble(field, &ok)
+                                : QString::fromUtf8(field.data, field.size).trimmed().toDouble(&ok);
+            if (ok) {
+                sum += value;
+                result.fields++;
+            }
+        }
+    }
+    result.nsecs = timer.nsecsElapsed();
+    Q_UNUSED(sum);
+    return result;
+}
+
+static void report(QTextStream& out, const QString& name, const BenchResult& result, qint64 bytes, qint64 baselineNsecs)
+{
+    double seconds = result.nsecs / 1e9;
+    double throughput = seconds > 0 ? bytes / seconds / (1024.0 * 1024.0) : 0.0;
+    double speedup = result.nsecs > 0 ? double(baselineNsecs) / result.nsecs : 0.0;
+    out << QString("  %1 %2 ms %3 MB/s  x%4  rows=%5 fields=%6")
+           .arg(name, -12)
+           .arg(result.nsecs / 1e6, 10, 'f', 1)
+           .arg(throughput, 9, 'f', 1)
+           .arg(speedup, 6, 'f', 2)
+           .arg(result.rows)
+           .arg(result.fields)
+        << "\n";
+}
+
+// 多次运行取最快的一次
+template <typename Func>
+static BenchResult bestOf(int repeat, Func func)
+{
+    BenchResult best;
+    for (int i = 0; i < repeat; ++i) {
+        BenchResult result = func();
+        if (i == 0 || result.nsecs < best.nsecs)
+            best = result;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QStringList args = app.arguments().mid(1);
+    int repeat = 3;
+    if (args.size() >= 2 && args.first() == "-r") {
+        repeat = qMax(1, args.at(1).toInt());
+        args = args.mid(2);
+    }
+    if (args.isEmpty()) {
+        out << "usage: csvscan_bench [-r repeat] file.csv [...]\n";
+        return 1;
+    }
+
+    const CsvScanner::Kernel kernels[] = { CsvScanner::ScalarKernel, CsvScanner::Sse2Kernel, CsvScanner::Avx2Kernel };
+
+    for (const QString& filePath : args) {
+        CsvFile csv;
+        if (!csv.open(filePath)) {
+            out << "cannot open " << filePath << "\n";
+            continue;
+        }
+        qint64 bytes = QFileInfo(filePath).size();
+        out << filePath << " (" << bytes << " bytes, best of " << repeat << ")\n";
+
+        BenchResult baseline = bestOf(repeat, [&]() { return runSplit(filePath); });
+        report(out, "split", baseline, bytes, baseline.nsecs);
+
+        for (CsvScanner::Kernel kernel : kernels) {
+            if (!CsvScanner::isSupported(kernel))
+                continue;
+            QString name = QString::fromLatin1(CsvScanner::kernelName(kernel)).toLower();
+            report(out, "scan-" + name, bestOf(repeat, [&]() { return runScan(csv, kernel); }), bytes, baseline.nsecs);
+            report(out, "reader-" + name, bestOf(repeat, [&]() { return runReader(csv, kernel); }), bytes, baseline.nsecs);
+        }
+
+        report(out, "number-qt", bestOf(repeat, [&]() { return runNumbers(csv, false); }), bytes, baseline.nsecs);
+        report(out, "number-fast", bestOf(repeat, [&]() { return runNumbers(csv, true); }), bytes, baseline.nsecs);
+    }
+    return 0;
+}
@@ -0,0 +1,320 @@
+#include "csvcache.h"
+#include "csvtable.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char kMagic[8] = {'C', 'S', 'V', 'C', 'A', 'C', 'H', 'E'};
+const quint32 kVersion = 2;
+
+// 小文件解析只需几毫秒，不值得占用磁盘
+const qint64 kMinCachedSize = 1024 * 1024;
+const qint64 kDefaultMaxSize = qint64(2) * 1024 * 1024 * 1024;
+// 写入时每次写出的最大字节数（取消的粒度）
+const qint64 kWriteChunkSize = 4 * 1024 * 1024;
+
+// 内容指纹的采样：文件头尾各一大块，中间均匀取若干小块
+const qint64 kEdgeSampleSize = 64 * 1024;
+const qint64 kInnerSampleSize = 4 * 1024;
+const int kInnerSampleCount = 16;
+
+// 缓存文件头，之后依次为：源文件路径（UTF-8，补齐到8字节）、保存的列号（quint32，补齐到8字节）、行偏移、各数值列
+struct CacheHeader {
+    char magic[8];
+    quint32 version;
+    quint32 headerSize;
+    qint64 fileSize;
+    qint64 lastModified;  // 毫秒
+    quint8 fingerprint[20];
+    quint32 columnCount;  // 最宽一行的字段数
+    quint32 storedColumns;  // 缓存中保存的列数
+    quint32 rowCount;
+    quint32 pathSize;
+    quint32 reserved;
+};
+static_assert(sizeof(CacheHeader) == 72, "CacheHeader layout must stay fixed");
+
+QString& cacheDirectory()
+{
+    static QString directory;
+    return directory;
+}
+
+qint64& cacheMaxSize()
+{
+    static qint64 size = kDefaultMaxSize;
+    return size;
+}
+
+QMutex& cacheMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+qint64 alignedSize(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+// 以源文件绝对路径的SHA-1命名
+QString cacheFilePath(const QByteArray& sourcePath)
+{
+    QString dir = CsvCache::directory();
+    if (dir.isEmpty())
+        return QString();
+    QByteArray key = QCryptographicHash::hash(sourcePath, QCryptographicHash::Sha1).toHex();
+    return QDir(dir).filePath(QString::fromLatin1(key) + ".csvcache");
+}
+
+void addHashData(QCryptographicHash& hash, const char* data, qint64 size)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 4, 0)
+    hash.addData(QByteArrayView(data, size));
+#else
+    hash.addData(data, int(size));
+#endif
+}
+
+QByteArray fingerprint(const CsvFile& source)
+{
+    const char* data = source.data();
+    const qint64 size = source.size();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    addHashData(hash, reinterpret_cast<const char*>(&size), sizeof(size));
+    if (size <= 2 * kEdgeSampleSize) {
+        addHashData(hash, data, size);
+        return hash.result();
+    }
+
+    addHashData(hash, data, kEdgeSampleSize);
+    for (int i = 1; i <= kInnerSampleCount; ++i) {
+        qint64 pos = size * i / (kInnerSampleCount + 1);
+        addHashData(hash, data + pos, qMin(kInnerSampleSize, size - pos));
+    }
+    addHashData(hash, data + size - kEdgeSampleSize, kEdgeSampleSize);
+    return hash.result();
+}
+
+// 把映射中的一段数据作为 QVector 使用：Qt 6 直接引用映射（QList::fromRawData），
+// Qt 5 的 QVector 不能引用外部数据，只能复制一份
+template <typename T>
+QVector<T> mappedVector(const uchar* data, int count)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return QVector<T>::fromRawData(reinterpret_cast<const T*>(data), count);
+#else
+    QVector<T> values(count);
+    std::memcpy(values.data(), data, size_t(count) * sizeof(T));
+    return values;
+#endif
+}
+
+bool writeBytes(QSaveFile& file, const void* data, qint64 size, CsvLoadControl* control)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        if (control && control->isCancelled())
+            return false;
+        const qint64 chunk = qMin(size, kWriteChunkSize);
+        if (file.write(bytes, chunk) != chunk)
+            return false;
+        bytes += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+// 缓存目录超过大小上限时从最久未使用的缓存开始删除（keepPath 除外）；
+// 正在被映射的缓存在某些平台上无法删除，直接跳过
+void evict(const QString& keepPath)
+{
+    const QString dir = CsvCache::directory();
+    const qint64 limit = CsvCache::maxSize();
+    // 按修改时间从新到旧排列，读取缓存时会更新修改时间
+    QFileInfoList entries = QDir(dir).entryInfoList(QStringList() << "*.csvcache", QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo& entry : entries) {
+        total += entry.size();
+        if (total > limit && entry.absoluteFilePath() != QFileInfo(keepPath).absoluteFilePath()) {
+            if (QFile::remove(entry.absoluteFilePath()))
+                total -= entry.size();
+        }
+    }
+}
+
+} // namespace
+
+namespace CsvCache {
+
+void setDirectory(const QString& directory)
+{
+    QMutexLocker locker(&cacheMutex());
+    cacheDirectory() = directory;
+}
+
+QString directory()
+{
+    QMutexLocker locker(&cacheMutex());
+    return cacheDirectory();
+}
+
+void setMaxSize(qint64 bytes)
+{
+    QMutexLocker locker(&cacheMutex());
+    cacheMaxSize() = bytes;
+}
+
+qint64 maxSize()
+{
+    QMutexLocker locker(&cacheMutex());
+    return cacheMaxSize();
+}
+
+bool read(const QString& filePath, const CsvFile& source, qint64 fileSize, qint64 lastModified, CsvCacheData& data)
+{
+    if (fileSize < kMinCachedSize)
+        return false;
+    QByteArray path = QFileInfo(filePath).absoluteFilePath().toUtf8();
+    QString cachePath = cacheFilePath(path);
+    if (cachePath.isEmpty())
+        return false;
+
+    // 映射随 QFile 一起释放
+    QSharedPointer<QFile> file(new QFile(cachePath));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(CacheHeader)))
+        return false;
+    const qint64 cacheSize = file->size();
+    const uchar* mapped = file->map(0, cacheSize);
+    if (!mapped)
+        return false;
+
+    // 校验文件头和源文件标识
+    CacheHeader header;
+    std::memcpy(&header, mapped, sizeof(header));
+    const qint64 pathOffset = sizeof(CacheHeader);
+    const qint64 indicesOffset = pathOffset + alignedSize(header.pathSize);
+    const qint64 offsetsOffset = indicesOffset + alignedSize(qint64(header.storedColumns) * sizeof(quint32));
+    const qint64 columnsOffset = offsetsOffset + qint64(header.rowCount) * sizeof(qint64);
+    const qint64 columnBytes = qint64(header.rowCount) * sizeof(double);
+    bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+            && header.version == kVersion
+            && header.headerSize == sizeof(CacheHeader)
+            && header.fileSize == fileSize
+            && header.lastModified == lastModified
+            && header.storedColumns <= header.columnCount
+            && header.rowCount <= quint32(std::numeric_limits<int>::max())
+            && int(header.pathSize) == path.size()
+            && cacheSize == columnsOffset + columnBytes * header.storedColumns
+            && std::memcmp(mapped + pathOffset, path.constData(), path.size()) == 0;
+    if (valid) {
+        QByteArray digest = fingerprint(source);
+        valid = std::memcmp(header.fingerprint, digest.constData(), sizeof(header.fingerprint)) == 0;
+    }
+    QVector<int> stored;
+    if (valid)
+        stored.resize(int(header.storedColumns));  // 列号表的大小已由文件大小校验
+    for (int i = 0; valid && i < stored.size(); ++i) {
+        quint32 column;
+        std::memcpy(&column, mapped + indicesOffset + i * sizeof(quint32), sizeof(column));
+        valid = column < header.columnCount;
+        stored[i] = int(column);
+    }
+    if (!valid)
+        return false;
+
+    // 行偏移和数值列直接引用映射（各段都按8字节对齐）
+    const int rowCount = int(header.rowCount);
+    data = CsvCacheData();
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    data.mapping = file;
+#endif
+    data.rowOffsets = mappedVector<qint64>(mapped + offsetsOffset, rowCount);
+    data.columnCount = int(header.columnCount);
+    data.columns.resize(data.columnCount);
+    for (int i = 0; i < stored.size(); ++i)
+        data.columns[stored[i]] = mappedVector<double>(mapped + columnsOffset + columnBytes * i, rowCount);
+
+    // 更新修改时间作为最近使用时间（淘汰时参考）
+    QFile touch(cachePath);
+    if (touch.open(QIODevice::Append))
+        touch.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+bool write(const QString& filePath, const CsvFile& source, qint64 fileSize, qint64 lastModified,
+           const QVector<qint64>& rowOffsets, int columnCount, const QVector<QVector<double>>& columns,
+           CsvLoadControl* control)
+{
+    if (fileSize < kMinCachedSize)
+        return false;
+    QByteArray path = QFileInfo(filePath).absoluteFilePath().toUtf8();
+    QString cachePath = cacheFilePath(path);
+    if (cachePath.isEmpty() || !QDir().mkpath(QFileInfo(cachePath).absolutePath()))
+        return false;
+
+    // 只保存已解析的列，缓存的总大小不超过源文件
+    const int rowCount = rowOffsets.size();
+    const qint64 columnBytes = qint64(rowCount) * sizeof(double);
+    qint64 cacheSize = sizeof(CacheHeader) + alignedSize(path.size()) + qint64(rowCount) * sizeof(qint64);
+    QVector<quint32> stored;
+    for (int column = 0; column < columns.size(); ++column) {
+        if (columns[column].size() != rowCount)
+            continue;
+        const qint64 grown = cacheSize + columnBytes + alignedSize(qint64(stored.size() + 1) * sizeof(quint32));
+        if (grown > fileSize)
+            break;
+        stored.append(quint32(column));
+        cacheSize += columnBytes;
+    }
+    if (stored.isEmpty())
+        return false;  // 连一列都放不下时缓存不比重新解析划算
+
+    QByteArray digest = fingerprint(source);
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerSize = sizeof(CacheHeader);
+    header.fileSize = fileSize;
+    header.lastModified = lastModified;
+    std::memcpy(header.fingerprint, digest.constData(), sizeof(header.fingerprint));
+    header.columnCount = quint32(columnCount);
+    header.storedColumns = quint32(stored.size());
+    header.rowCount = quint32(rowCount);
+    header.pathSize = quint32(path.size());
+
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    path.append(QByteArray(int(alignedSize(path.size()) - path.size()), '\0'));
+    const qint64 indicesSize = qint64(stored.size()) * sizeof(quint32);
+    QByteArray indices(reinterpret_cast<const char*>(stored.constData()), int(indicesSize));
+    indices.append(QByteArray(int(alignedSize(indicesSize) - indicesSize), '\0'));
+    bool ok = writeBytes(file, &header, sizeof(header), control)
+            && writeBytes(file, path.constData(), path.size(), control)
+            && writeBytes(file, indices.constData(), indices.size(), control)
+            && writeBytes(file, rowOffsets.constData(), qint64(rowCount) * sizeof(qint64), control);
+    for (int i = 0; ok && i < stored.size(); ++i)
+        ok = writeBytes(file, columns[int(stored[i])].constData(), columnBytes, control);
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit())
+        return false;
+    evict(cachePath);
+    return true;
+}
+
+} // namespace CsvCache
@@ -0,0 +1,46 @@
+#ifndef CSVCACHE_H
+#define CSVCACHE_H
+
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include "csvfile.h"
+
+class CsvLoadControl;
+
+// 从缓存读出的表格数据。Qt 6 下行偏移和数值列直接指向缓存文件的映射（QList::fromRawData），不复制数据；
+// 映射由 mapping 持有，只要这些 QVector 还在使用就必须保留，修改它们时 QVector 会先复制出独立的副本。
+// Qt 5 的 QVector 不能引用外部数据，读出时复制一份，mapping 为空
+struct CsvCacheData {
+    QSharedPointer<QFile> mapping;
+    QVector<qint64> rowOffsets;
+    int columnCount = 0;  // 最宽一行的字段数
+    QVector<QVector<double>> columns;  // 下标为列号，未缓存的列为空
+};
+
+// 已解析CSV表格的二进制缓存（行偏移 + 用到的数值列，按本机字节序原样存储，直接映射读取）
+// 缓存文件以源文件绝对路径命名，并记录源文件的大小、修改时间和内容指纹（文件头尾及均匀分布的采样块的SHA-1），
+// 任何一项不一致即视为失效，重新解析后覆盖。
+// 每个缓存文件不超过源文件的大小；缓存目录超过总大小上限时按最近使用时间删除最旧的缓存
+namespace CsvCache {
+
+// 缓存目录，为空时禁用缓存（默认禁用）；应在开始加载前设置
+void setDirectory(const QString& directory);
+QString directory();
+// 缓存目录的总大小上限（默认 2 GB）
+void setMaxSize(qint64 bytes);
+qint64 maxSize();
+
+// 校验通过时映射缓存文件并返回其中的数据，同时把它标记为最近使用
+bool read(const QString& filePath, const CsvFile& source, qint64 fileSize, qint64 lastModified, CsvCacheData& data);
+
+// 写入缓存（先写临时文件再替换）：保存行偏移和 columns 中已解析的列（按列号依次加入，直到达到源文件大小）。
+// 源文件过小、缓存被禁用或 control 被取消时不写
+bool write(const QString& filePath, const CsvFile& source, qint64 fileSize, qint64 lastModified,
+           const QVector<qint64>& rowOffsets, int columnCount, const QVector<QVector<double>>& columns,
+           CsvLoadControl* control = nullptr);
+
+} // namespace CsvCache
+
+#endif // CSVCACHE_H
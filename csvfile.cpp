@@ -0,0 +1,211 @@
+#include "csvfile.h"
+#include "csvnumber.h"
+#include <cstring>
+
+static inline bool isCsvSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+CsvField CsvField::trimmed() const
+{
+    const char* begin = data;
+    const char* end = data + size;
+    while (begin < end && isCsvSpace(*begin))
+        ++begin;
+    while (end > begin && isCsvSpace(*(end - 1)))
+        --end;
+    CsvField result;
+    result.data = begin;
+    result.size = int(end - begin);
+    return result;
+}
+
+CsvField CsvField::unquoted() const
+{
+    CsvField result = *this;
+    if (size >= 2 && data[0] == '"' && data[size - 1] == '"') {
+        result.data = data + 1;
+        result.size = size - 2;
+    }
+    return result;
+}
+
+QString CsvField::toString() const
+{
+    CsvField t = trimmed();
+    if (t.size >= 2 && t.data[0] == '"' && t.data[t.size - 1] == '"') {
+        CsvField inner = t.unquoted();
+        return QString::fromUtf8(inner.data, inner.size).replace(QLatin1String("\"\""), QLatin1String("\""));
+    }
+    return QString::fromUtf8(data, size);
+}
+
+CsvFile::CsvFile()
+    : mData(nullptr), mSize(0), mStartOffset(0), mOpen(false)
+{
+}
+
+CsvFile::~CsvFile()
+{
+    close();
+}
+
+bool CsvFile::open(const QString& filePath)
+{
+    close();
+
+    mFile.setFileName(filePath);
+    if (!mFile.open(QIODevice::ReadOnly))
+        return false;
+
+    mSize = mFile.size();
+    if (mSize > 0) {
+        uchar* mapped = mFile.map(0, mSize);
+        if (mapped) {
+            mData = reinterpret_cast<const char*>(mapped);
+        } else {
+            // 映射失败（例如特殊文件系统），退化为一次性读入
+            mBuffer = mFile.readAll();
+            mData = mBuffer.constData();
+            mSize = mBuffer.size();
+        }
+    }
+
+    // 跳过UTF-8 BOM（QTextStream 也会自动去掉）
+    if (mSize >= 3 && std::memcmp(mData, "\xEF\xBB\xBF", 3) == 0)
+        mStartOffset = 3;
+
+    mOpen = true;
+    return true;
+}
+
+void CsvFile::close()
+{
+    if (mFile.isOpen()) {
+        if (mData && mBuffer.isEmpty())
+            mFile.unmap(reinterpret_cast<uchar*>(const_cast<char*>(mData)));
+        mFile.close();
+    }
+    mBuffer.clear();
+    mData = nullptr;
+    mSize = 0;
+    mStartOffset = 0;
+    mOpen = false;
+}
+
+QStringList CsvFile::toStringList(const QVector<CsvField>& fields)
+{
+    QStringList result;
+    result.reserve(fields.size());
+    for (const CsvField& field : fields)
+        result.append(field.toString());
+    return result;
+}
+
+double CsvFile::toDouble(const CsvField& field, bool* ok)
+{
+    CsvField t = field.trimmed().unquoted();
+    double value = 0.0;
+    bool success = CsvNumber::parseDouble(t.data, t.data + t.size, value);
+    if (ok)
+        *ok = success;
+    return success ? value : 0.0;
+}
+
+// 初始块大小；遇到超长行时按需加倍
+static const int kReaderBlockSize = 1 << 20;
+
+CsvReader::CsvReader(const CsvFile& file, CsvScanner::Kernel kernel)
+    : mFile(file), mScanner(kernel), mBlockBegin(0), mBlockLength(0), mBlockCapacity(kReaderBlockSize),
+      mIndexCount(0), mIndexPos(0), mPos(0), mEnd(file.size()), mRowOffset(0)
+{
+    seek(file.startOffset());
+}
+
+void CsvReader::setRange(qint64 begin, qint64 end)
+{
+    mEnd = qMin(end, mFile.size());
+    seek(begin);
+}
+
+void CsvReader::seek(qint64 offset)
+{
+    mPos = offset;
+    mRowOffset = offset;
+    mBlockBegin = offset;
+    mBlockLength = 0;
+    mIndexCount = 0;
+    mIndexPos = 0;
+}
+
+void CsvReader::fillIndex(qint64 rowStart)
+{
+    // 一整块都装不下当前行时扩大块
+    if (rowStart == mBlockBegin && mBlockLength == mBlockCapacity)
+        mBlockCapacity *= 2;
+
+    mBlockBegin = rowStart;
+    mBlockLength = int(qMin<qint64>(mBlockCapacity, mEnd - rowStart));
+    if (mIndex.size() < mBlockLength)
+        mIndex.resize(mBlockLength);
+
+    bool inQuotes = false;  // 行首一定在引号外
+    mIndexCount = mScanner.scan(mFile.data() + rowStart, mBlockLength, mIndex.data(), inQuotes);
+    mIndexPos = 0;
+}
+
+bool CsvReader::readRow(CsvField& line, QVector<CsvField>& fields)
+{
+    if (mPos >= mEnd)
+        return false;
+
+    const char* data = mFile.data();
+    const qint64 rowStart = mPos;
+    qint64 fieldStart = rowStart;
+    qint64 rowEnd = mEnd;
+    fields.clear();
+
+    while (true) {
+        if (mIndexPos >= mIndexCount) {
+            if (mBlockBegin + mBlockLength >= mEnd) {
+                // 最后一行没有换行符
+                rowEnd = mEnd;
+                mPos = mEnd;
+                break;
+            }
+            // 当前行跨越了块边界：从行首重新建立索引
+            fillIndex(rowStart);
+            fieldStart = rowStart;
+            fields.clear();
+            continue;
+        }
+
+        qint64 pos = mBlockBegin + mIndex[mIndexPos++];
+        if (data[pos] == '\n') {
+            rowEnd = pos;
+            mPos = pos + 1;
+            break;
+        }
+
+        CsvField field;
+        field.data = data + fieldStart;
+        field.size = int(pos - fieldStart);
+        fields.append(field);
+        fieldStart = pos + 1;
+    }
+
+    // 兼容 Windows 换行符
+    if (rowEnd > fieldStart && data[rowEnd - 1] == '\r')
+        --rowEnd;
+
+    CsvField last;
+    last.data = data + fieldStart;
+    last.size = int(rowEnd - fieldStart);
+    fields.append(last);
+
+    line.data = data + rowStart;
+    line.size = int(rowEnd - rowStart);
+    mRowOffset = rowStart;
+    return true;
+}
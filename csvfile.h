@@ -0,0 +1,85 @@
+#ifndef CSVFILE_H
+#define CSVFILE_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include "csvscanner.h"
+
+// 指向文件映射内存中一段字节的视图（不拥有数据，也不分配内存）
+struct CsvField {
+    const char* data = nullptr;
+    int size = 0;
+
+    bool isEmpty() const { return size == 0; }
+    CsvField trimmed() const;  // 去掉首尾空白（仅调整视图范围）
+    CsvField unquoted() const;  // 去掉包围字段的一对双引号
+    QString toString() const;  // 解码为文本，引号字段中的 "" 还原为 "
+};
+
+// 基于内存映射的CSV读取引擎
+// 整个文件映射到内存后按行、按字段返回字节视图，解析过程中不为每个字段分配内存
+class CsvFile
+{
+public:
+    CsvFile();
+    ~CsvFile();
+
+    bool open(const QString& filePath);
+    void close();
+    bool isOpen() const { return mOpen; }
+
+    QString filePath() const { return mFile.fileName(); }
+    qint64 size() const { return mSize; }
+    const char* data() const { return mData; }
+    qint64 startOffset() const { return mStartOffset; }  // 跳过UTF-8 BOM后的第一行位置
+
+    static QStringList toStringList(const QVector<CsvField>& fields);
+    // 与 QString::trimmed().toDouble() 语义一致的数值转换
+    static double toDouble(const CsvField& field, bool* ok);
+
+private:
+    Q_DISABLE_COPY(CsvFile)
+
+    QFile mFile;
+    QByteArray mBuffer;  // 无法映射时（例如空文件）退化为一次性读入
+    const char* mData;
+    qint64 mSize;
+    qint64 mStartOffset;
+    bool mOpen;
+};
+
+// 顺序读取CSV行
+// 按块用 CsvScanner 建立结构字符索引，再按索引切出行和字段；引号内的逗号和换行不作为分隔符
+class CsvReader
+{
+public:
+    explicit CsvReader(const CsvFile& file, CsvScanner::Kernel kernel = CsvScanner::bestKernel());
+
+    void seek(qint64 offset);  // offset 必须位于行首
+    void setRange(qint64 begin, qint64 end);  // 只读取起始位置在 [begin, end) 内的行，两端都必须是行首
+    // 读取下一行（不含 "\n" 或 "\r\n"），fields 由调用方复用以避免重复分配；到达文件末尾返回 false
+    bool readRow(CsvField& line, QVector<CsvField>& fields);
+
+    qint64 rowOffset() const { return mRowOffset; }  // 最近读取的一行的起始偏移
+    qint64 position() const { return mPos; }  // 下一行的起始偏移
+
+private:
+    void fillIndex(qint64 rowStart);
+
+    const CsvFile& mFile;
+    CsvScanner mScanner;
+    QVector<quint32> mIndex;  // 当前块内结构字符相对块起点的偏移
+    qint64 mBlockBegin;
+    int mBlockLength;
+    int mBlockCapacity;
+    int mIndexCount;
+    int mIndexPos;
+    qint64 mPos;
+    qint64 mEnd;
+    qint64 mRowOffset;
+};
+
+#endif // CSVFILE_H
@@ -0,0 +1,184 @@
+#include "csvloader.h"
+#include <QMutexLocker>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// 按原 loadCSV 的规则接收一个X/Y都有效的数据点
+inline void acceptPoint(CsvLoadResult& result, int row, double x, double y, bool isLogX)
+{
+    // 对数坐标轴下X必须>0
+    if (isLogX && x <= 0) {
+        result.filteredLogPoints++;
+        result.skippedLines++;
+    } else {
+        result.points.append(QCPGraphData(x, y));
+        result.rows.append(row);  // 记录原始行号
+        result.validDataLines++;
+    }
+}
+
+} // namespace
+
+QVector<qint64> CsvLoader::findChunkBoundaries(const CsvFile& file, int chunkCount)
+{
+    const char* data = file.data();
+    const qint64 begin = file.startOffset();
+    const qint64 end = file.size();
+    chunkCount = qMax(1, chunkCount);
+
+    // 先按字节平均切分
+    QVector<qint64> starts(chunkCount + 1);
+    for (int i = 0; i <= chunkCount; ++i)
+        starts[i] = begin + (end - begin) * i / chunkCount;
+
+    // 第一遍：并行统计每块中的引号个数
+    QVector<qint64> quoteCounts(chunkCount);
+    QVector<int> indexes(chunkCount);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    QtConcurrent::blockingMap(indexes, [&](int i) {
+        quoteCounts[i] = std::count(data + starts[i], data + starts[i + 1], '"');
+    });
+
+    // 引号个数的前缀奇偶性给出每块起点是否位于引号内，
+    // 由此向后找到第一个引号外的换行符，其后即为安全的行首
+    QVector<qint64> boundaries(chunkCount + 1);
+    boundaries[0] = begin;
+    boundaries[chunkCount] = end;
+    bool inQuotes = false;
+    for (int i = 1; i < chunkCount; ++i) {
+        if (quoteCounts[i - 1] & 1)
+            inQuotes = !inQuotes;
+
+        qint64 pos = starts[i];
+        if (inQuotes || pos <= begin || data[pos - 1] != '\n') {
+            bool quoted = inQuotes;
+            while (pos < end) {
+                char c = data[pos++];
+                if (c == '"')
+                    quoted = !quoted;
+                else if (c == '\n' && !quoted)
+                    break;
+            }
+        }
+        // 超长行可能跨越多块，保证边界单调（此时中间的块为空）
+        boundaries[i] = qMax(pos, boundaries[i - 1]);
+    }
+    return boundaries;
+}
+
+bool CsvLoader::load(const QString& filePath, int xCol, int yCol, bool isLogX, CsvLoadResult& result,
+                     CsvLoadControl* control)
+{
+    QSharedPointer<CsvTable> table = CsvTable::open(filePath, QVector<int>() << xCol << yCol, control);
+    if (!table) {
+        result = CsvLoadResult();
+        return false;
+    }
+    return extract(table, xCol, yCol, isLogX, result);
+}
+
+bool CsvLoader::extract(const QSharedPointer<CsvTable>& source, int xCol, int yCol, bool isLogX, CsvLoadResult& result)
+{
+    result = CsvLoadResult();
+    result.table = source;
+    if (!result.table)
+        return false;
+    result.table->ensureNumericColumns(QVector<int>() << xCol << yCol);
+
+    const CsvTable& table = *result.table;
+    QMutexLocker locker(table.dataMutex());
+    const QVector<double>& xs = table.numericColumn(xCol);
+    const QVector<double>& ys = table.numericColumn(yCol);
+    const int rowCount = table.rowCount();
+    if (xs.size() != rowCount || ys.size() != rowCount) {
+        // 列索引无效
+        result.skippedLines = rowCount;
+        return false;
+    }
+
+    result.points.reserve(rowCount);
+    result.rows.reserve(rowCount);
+
+    bool firstRowInvalid = false;
+    for (int row = 0; row < rowCount; ++row) {
+        double x = xs[row];
+        double y = ys[row];
+
+        // 只有当X和Y都是数字时才添加数据点（空行、列数不足的行同样无效）
+        if (CsvTable::isMissing(x) || CsvTable::isMissing(y)) {
+            if (row == 0)
+                firstRowInvalid = true;
+            result.skippedLines++;
+            continue;
+        }
+
+        acceptPoint(result, row, x, y, isLogX);
+    }
+    locker.unlock();
+
+    // 第一行列数足够但不是数字，可能是表头（文本访问自行加锁）
+    if (firstRowInvalid && table.fieldCount(0) > qMax(xCol, yCol)) {
+        result.hasHeader = true;
+        result.header = table.rowFields(0);
+    }
+
+    sortByKey(result.points, result.rows);
+    return !result.points.isEmpty();
+}
+
+bool CsvLoader::preview(const QString& filePath, int xCol, int yCol, bool isLogX, int maxRows, CsvLoadResult& result)
+{
+    result = CsvLoadResult();
+    CsvFile file;
+    if (!file.open(filePath))
+        return false;
+
+    CsvReader reader(file);
+    CsvField line;
+    QVector<CsvField> fields;
+    for (int row = 0; row < maxRows && reader.readRow(line, fields); ++row) {
+        bool xOk = false, yOk = false;
+        double x = 0, y = 0;
+        if (xCol >= 0 && yCol >= 0 && fields.size() > qMax(xCol, yCol)) {
+            x = CsvFile::toDouble(fields[xCol], &xOk);
+            y = CsvFile::toDouble(fields[yCol], &yOk);
+        }
+        if (!xOk || !yOk) {
+            if (row == 0 && fields.size() > qMax(xCol, yCol)) {
+                result.hasHeader = true;
+                result.header = CsvFile::toStringList(fields);
+            }
+            result.skippedLines++;
+            continue;
+        }
+        acceptPoint(result, row, x, y, isLogX);
+    }
+
+    sortByKey(result.points, result.rows);
+    return !result.points.isEmpty();
+}
+
+void CsvLoader::sortByKey(QVector<QCPGraphData>& points, QVector<int>& rows)
+{
+    auto byKey = [](const QCPGraphData& a, const QCPGraphData& b) { return a.key < b.key; };
+    if (std::is_sorted(points.constBegin(), points.constEnd(), byKey))
+        return;
+
+    // 对下标排序，再按排列同时重排数据点和行号
+    QVector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    const QCPGraphData* data = points.constData();
+    std::stable_sort(order.begin(), order.end(), [data](int a, int b) { return data[a].key < data[b].key; });
+
+    QVector<QCPGraphData> sortedPoints(points.size());
+    QVector<int> sortedRows(rows.size());
+    for (int i = 0; i < order.size(); ++i) {
+        sortedPoints[i] = points[order[i]];
+        sortedRows[i] = rows[order[i]];
+    }
+    points.swap(sortedPoints);
+    rows.swap(sortedRows);
+}
@@ -0,0 +1,45 @@
+#ifndef CSVLOADER_H
+#define CSVLOADER_H
+
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+#include "csvfile.h"
+#include "csvtable.h"
+#include "qcustomplot.h"
+
+// 从CSV文件提取一对X/Y列的结果
+struct CsvLoadResult {
+    QSharedPointer<CsvTable> table;  // 共享的列式表格
+    QVector<QCPGraphData> points;  // 按X排序，可直接交给 QCPGraphDataContainer::set(points, true)
+    QVector<int> rows;  // 每个数据点对应的表格行号（与 points 一一对应）
+    bool hasHeader = false;
+    QStringList header;
+    int skippedLines = 0;
+    int validDataLines = 0;
+    int filteredLogPoints = 0;  // 因对数X轴被过滤的点数
+};
+
+// CSV数据加载器
+// 从共享表格中取出X/Y列，按原 loadCSV 的规则判断表头、过滤无效行和对数坐标下 X≤0 的点。
+// 表格由多个线程分块解析：大文件按字节范围切块，在每块中找到安全的行首（正确处理引号内的换行），
+// 解析后按原始行顺序拼接，结果与单线程解析完全一致。
+class CsvLoader
+{
+public:
+    // 打开（或复用）文件对应的表格并取出X/Y列；可在工作线程中调用，被取消时返回 false 且 table 为空
+    static bool load(const QString& filePath, int xCol, int yCol, bool isLogX, CsvLoadResult& result,
+                     CsvLoadControl* control = nullptr);
+    // 只读取文件开头的 maxRows 行，用于完整加载结束前先显示部分数据（不建立表格）
+    static bool preview(const QString& filePath, int xCol, int yCol, bool isLogX, int maxRows, CsvLoadResult& result);
+    // 直接从已解析的表格中取出X/Y列，不访问磁盘（切换列时使用）
+    static bool extract(const QSharedPointer<CsvTable>& table, int xCol, int yCol, bool isLogX, CsvLoadResult& result);
+
+    // 按X稳定排序数据点（已有序时为 O(n) 检查），rows 随之重排
+    static void sortByKey(QVector<QCPGraphData>& points, QVector<int>& rows);
+
+    // 把数据区切成最多 chunkCount 块，返回 chunkCount + 1 个单调不减的行首偏移（最后一个为文件末尾）
+    static QVector<qint64> findChunkBoundaries(const CsvFile& file, int chunkCount);
+};
+
+#endif // CSVLOADER_H
@@ -0,0 +1,25 @@
+#ifndef CSVNUMBER_H
+#define CSVNUMBER_H
+
+#include <QtGlobal>
+
+// 直接在字节范围上解析浮点数，不复制、不分配内存、与区域设置无关
+// 采用 Eisel-Lemire 算法：用128位的5的幂近似值一次乘法得到正确舍入的结果，
+// 少数无法判定的情况（超过19位有效数字）退回 Qt 的精确转换。
+// 输出时生成能精确还原同一个 double 的最短十进制表示。
+namespace CsvNumber {
+
+// formatDouble 输出的最大长度
+const int kMaxFormattedSize = 32;
+
+// 解析 [begin, end)，允许首尾空白、正负号、小数、指数以及 inf/nan（不区分大小写）；
+// 格式不正确或溢出时返回 false，语义与 QString::trimmed().toDouble() 一致
+bool parseDouble(const char* begin, const char* end, double& value);
+
+// 把 value 写成最短的可往返表示（如 0.1、1e+300），不写结尾的 0 字符，返回长度；
+// buffer 至少 kMaxFormattedSize 字节。标准库支持 std::to_chars 时使用它（Ryu），否则用 Qt 的最短格式
+int formatDouble(double value, char* buffer);
+
+} // namespace CsvNumber
+
+#endif // CSVNUMBER_H
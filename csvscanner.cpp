@@ -0,0 +1,226 @@
+#include "csvscanner.h"
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#  define CSV_SCANNER_X86
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define CSV_TARGET_SSE2
+#    define CSV_TARGET_AVX2
+#  else
+#    define CSV_TARGET_SSE2 __attribute__((target("sse2")))
+#    define CSV_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#endif
+
+namespace {
+
+// 一个64字节块中三类字符的位掩码（第 i 位对应第 i 个字节）
+struct BlockMasks {
+    quint64 comma;
+    quint64 newline;
+    quint64 quote;
+};
+
+// 前缀异或：第 i 位等于第 0..i 位的异或，用于由引号位置推出“位于引号内”的区间
+inline quint64 prefixXor(quint64 x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// 由块掩码计算结构字符（引号外的逗号和换行）并写出偏移
+inline int emitStructurals(const BlockMasks& masks, quint32 base, quint64 validBits, quint32* out, bool& inQuotes)
+{
+    quint64 quoted = prefixXor(masks.quote & validBits) ^ (inQuotes ? ~quint64(0) : quint64(0));
+    inQuotes = (quoted >> 63) != 0;
+
+    quint64 bits = (masks.comma | masks.newline) & ~quoted & validBits;
+    int count = 0;
+    while (bits) {
+        out[count++] = base + quint32(qCountTrailingZeroBits(bits));
+        bits &= bits - 1;
+    }
+    return count;
+}
+
+inline void scalarMasks(const char* p, BlockMasks& masks)
+{
+    masks.comma = masks.newline = masks.quote = 0;
+    for (int i = 0; i < 64; ++i) {
+        quint64 bit = quint64(1) << i;
+        switch (p[i]) {
+        case ',':  masks.comma |= bit; break;
+        case '\n': masks.newline |= bit; break;
+        case '"':  masks.quote |= bit; break;
+        default: break;
+        }
+    }
+}
+
+// 按64字节块驱动某个掩码函数；末尾不足64字节的部分补零后走同一路径
+template <void (*Masks)(const char*, BlockMasks&)>
+inline int scanBlocks(const char* data, int size, quint32* out, bool& inQuotes)
+{
+    int count = 0;
+    int pos = 0;
+    BlockMasks masks;
+    for (; pos + 64 <= size; pos += 64) {
+        Masks(data + pos, masks);
+        count += emitStructurals(masks, quint32(pos), ~quint64(0), out + count, inQuotes);
+    }
+    if (pos < size) {
+        char tail[64];
+        std::memset(tail, 0, sizeof(tail));
+        std::memcpy(tail, data + pos, size_t(size - pos));
+        Masks(tail, masks);
+        quint64 validBits = (quint64(1) << (size - pos)) - 1;
+        count += emitStructurals(masks, quint32(pos), validBits, out + count, inQuotes);
+    }
+    return count;
+}
+
+int scanScalar(const char* data, int size, quint32* out, bool& inQuotes)
+{
+    return scanBlocks<scalarMasks>(data, size, out, inQuotes);
+}
+
+#ifdef CSV_SCANNER_X86
+
+CSV_TARGET_SSE2 inline void sse2Masks(const char* p, BlockMasks& masks)
+{
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i quote = _mm_set1_epi8('"');
+    masks.comma = masks.newline = masks.quote = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+        masks.comma |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, comma)))) << (i * 16);
+        masks.newline |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)))) << (i * 16);
+        masks.quote |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)))) << (i * 16);
+    }
+}
+
+CSV_TARGET_SSE2 int scanSse2(const char* data, int size, quint32* out, bool& inQuotes)
+{
+    return scanBlocks<sse2Masks>(data, size, out, inQuotes);
+}
+
+CSV_TARGET_AVX2 inline void avx2Masks(const char* p, BlockMasks& masks)
+{
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i quote = _mm256_set1_epi8('"');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    masks.comma = quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma))))
+                | quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)))) << 32;
+    masks.newline = quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline))))
+                  | quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)))) << 32;
+    masks.quote = quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote))))
+                | quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)))) << 32;
+}
+
+CSV_TARGET_AVX2 int scanAvx2(const char* data, int size, quint32* out, bool& inQuotes)
+{
+    return scanBlocks<avx2Masks>(data, size, out, inQuotes);
+}
+
+bool cpuHasSse2()
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;  // x86-64 的基本指令集
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    // 还需要操作系统保存YMM寄存器状态
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // CSV_SCANNER_X86
+
+} // namespace
+
+CsvScanner::CsvScanner(Kernel kernel)
+    : mKernel(isSupported(kernel) ? kernel : ScalarKernel), mScan(scanScalar)
+{
+#ifdef CSV_SCANNER_X86
+    if (mKernel == Avx2Kernel)
+        mScan = scanAvx2;
+    else if (mKernel == Sse2Kernel)
+        mScan = scanSse2;
+#endif
+}
+
+CsvScanner::Kernel CsvScanner::bestKernel()
+{
+    static const Kernel best = isSupported(Avx2Kernel) ? Avx2Kernel
+                             : isSupported(Sse2Kernel) ? Sse2Kernel
+                             : ScalarKernel;
+    return best;
+}
+
+bool CsvScanner::isSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case ScalarKernel:
+        return true;
+#ifdef CSV_SCANNER_X86
+    case Sse2Kernel: {
+        static const bool supported = cpuHasSse2();
+        return supported;
+    }
+    case Avx2Kernel: {
+        static const bool supported = cpuHasAvx2();
+        return supported;
+    }
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* CsvScanner::kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Sse2Kernel: return "SSE2";
+    case Avx2Kernel: return "AVX2";
+    default:         return "Scalar";
+    }
+}
+
+int CsvScanner::scan(const char* data, int size, quint32* out, bool& inQuotes) const
+{
+    return mScan(data, size, out, inQuotes);
+}
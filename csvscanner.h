@@ -0,0 +1,37 @@
+#ifndef CSVSCANNER_H
+#define CSVSCANNER_H
+
+#include <QtGlobal>
+
+// CSV结构字符扫描器
+// 每次处理64字节，找出引号外的逗号和换行符，输出它们的偏移（字段分隔索引）。
+// 根据CPU在运行时选择 AVX2 / SSE2 / 标量实现，三者输出完全一致。
+class CsvScanner
+{
+public:
+    enum Kernel {
+        ScalarKernel,
+        Sse2Kernel,
+        Avx2Kernel
+    };
+
+    explicit CsvScanner(Kernel kernel = bestKernel());
+
+    static Kernel bestKernel();
+    static bool isSupported(Kernel kernel);
+    static const char* kernelName(Kernel kernel);
+
+    Kernel kernel() const { return mKernel; }
+
+    // 扫描 [data, data + size)，把引号外逗号和换行符相对 data 的偏移写入 out（容量至少为 size），
+    // 返回写入的个数。inQuotes 在多次调用之间传递引号状态，便于分块扫描。
+    int scan(const char* data, int size, quint32* out, bool& inQuotes) const;
+
+private:
+    typedef int (*ScanFunction)(const char* data, int size, quint32* out, bool& inQuotes);
+
+    Kernel mKernel;
+    ScanFunction mScan;
+};
+
+#endif // CSVSCANNER_H
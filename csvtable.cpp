@@ -0,0 +1,575 @@
+#include "csvtable.h"
+#include "csvcache.h"
+#include "csvloader.h"
+#include <QFileInfo>
+#include <QHash>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtNumeric>
+#include <QWeakPointer>
+#include <QtConcurrent>
+#include <cstring>
+
+namespace {
+
+// 无效单元格用一个特殊的 quiet NaN 表示，与解析 "nan" 得到的标准 NaN 区分
+const quint64 kMissingBits = Q_UINT64_C(0x7FF8DEADBEEF0001);
+
+// 小于该大小的文件直接单线程解析
+const qint64 kParallelThreshold = 8 * 1024 * 1024;
+// 每块至少包含的字节数，避免切得过碎
+const qint64 kMinChunkSize = 2 * 1024 * 1024;
+// 每解析这么多行汇报一次进度并检查是否取消
+const int kProgressInterval = 4096;
+// 列概况抽样：在文件中均匀分布若干段，每段连续读取若干行
+const int kProfileRuns = 64;
+const int kProfileRunLength = 32;
+
+// 已打开表格的登记表（弱引用，最后一条曲线释放后表格随之关闭）
+QHash<QString, QWeakPointer<CsvTable>>& tableRegistry()
+{
+    static QHash<QString, QWeakPointer<CsvTable>> registry;
+    return registry;
+}
+
+// 登记表可能同时被界面线程和后台加载线程访问
+QMutex& tableRegistryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+// 列概况统计
+struct ColumnCounter {
+    int numeric = 0;
+    int empty = 0;
+    int nan = 0;
+    double minimum = qInf();
+    double maximum = -qInf();
+    double last = qQNaN();
+    bool increasing = true;
+    bool decreasing = true;
+    bool changed = false;
+
+    void add(double value)
+    {
+        minimum = qMin(minimum, value);
+        maximum = qMax(maximum, value);
+        if (!qIsNaN(last) && value != last) {
+            changed = true;
+            if (value < last)
+                increasing = false;
+            else
+                decreasing = false;
+        }
+        last = value;
+    }
+
+    CsvColumnProfile::Order order() const
+    {
+        if (changed && increasing)
+            return CsvColumnProfile::Increasing;
+        if (changed && decreasing)
+            return CsvColumnProfile::Decreasing;
+        return CsvColumnProfile::Unordered;
+    }
+};
+
+// 一块数据（起始位置在 [begin, end) 内的行）的解析结果
+struct ChunkData {
+    qint64 begin = 0;
+    qint64 end = 0;
+    int rowCount = 0;
+    int fieldCount = 0;  // 块内最宽一行的字段数
+    QVector<qint64> rowOffsets;
+    QVector<QVector<double>> columns;  // 与请求的列一一对应
+};
+
+inline double parseCell(const QVector<CsvField>& fields, int column)
+{
+    if (column < fields.size()) {
+        bool ok;
+        double value = CsvFile::toDouble(fields[column], &ok);
+        if (ok)
+            return value;
+    }
+    return CsvTable::missingValue();
+}
+
+// 建立行索引并解析指定的列
+void parseChunkRowIndex(const CsvFile& file, const QVector<int>& columns, ChunkData& chunk, CsvLoadControl* control)
+{
+    CsvReader reader(file);
+    reader.setRange(chunk.begin, chunk.end);
+    chunk.columns.resize(columns.size());
+
+    CsvField line;
+    QVector<CsvField> fields;  // 复用的字段缓冲区
+    qint64 reported = chunk.begin;
+    while (reader.readRow(line, fields)) {
+        if (control && chunk.rowCount % kProgressInterval == 0) {
+            if (control->isCancelled())
+                return;
+            control->addProgress(reader.position() - reported);
+            reported = reader.position();
+        }
+
+        chunk.rowOffsets.append(reader.rowOffset());
+        chunk.fieldCount = qMax(chunk.fieldCount, fields.size());
+        for (int i = 0; i < columns.size(); ++i)
+            chunk.columns[i].append(parseCell(fields, columns[i]));
+        chunk.rowCount++;
+    }
+    if (control)
+        control->addProgress(chunk.end - reported);
+}
+
+// 只解析指定的列（行索引已存在）
+void parseChunkColumns(const CsvFile& file, const QVector<int>& columns, ChunkData& chunk, CsvLoadControl* control)
+{
+    CsvReader reader(file);
+    reader.setRange(chunk.begin, chunk.end);
+    chunk.columns.resize(columns.size());
+
+    CsvField line;
+    QVector<CsvField> fields;
+    qint64 reported = chunk.begin;
+    while (reader.readRow(line, fields)) {
+        if (control && chunk.rowCount % kProgressInterval == 0) {
+            if (control->isCancelled())
+                return;
+            control->addProgress(reader.position() - reported);
+            reported = reader.position();
+        }
+
+        for (int i = 0; i < columns.size(); ++i)
+            chunk.columns[i].append(parseCell(fields, columns[i]));
+        chunk.rowCount++;
+    }
+    if (control)
+        control->addProgress(chunk.end - reported);
+}
+
+} // namespace
+
+CsvTable::CsvTable()
+    : mFileSize(0), mSource(new CsvFile), mColumnCount(0), mHasProfile(false)
+{
+}
+
+CsvTable::~CsvTable()
+{
+}
+
+double CsvTable::missingValue()
+{
+    double value;
+    std::memcpy(&value, &kMissingBits, sizeof(value));
+    return value;
+}
+
+bool CsvTable::isMissing(double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits == kMissingBits;
+}
+
+QSharedPointer<CsvTable> CsvTable::open(const QString& filePath, const QVector<int>& columns,
+                                        CsvLoadControl* control)
+{
+    QFileInfo info(filePath);
+    QString key = info.absoluteFilePath();
+
+    // 文件未被修改过时复用已打开的表格
+    QSharedPointer<CsvTable> table;
+    {
+        QMutexLocker locker(&tableRegistryMutex());
+        table = tableRegistry().value(key).toStrongRef();
+    }
+    if (table && table->isOpen() && table->mFileSize == info.size() && table->mLastModified == info.lastModified()) {
+        // 只需补充解析尚未缓存的列（切换到新的列时），同样汇报进度并可取消
+        if (control)
+            control->setTotal(table->mSource->size() - table->mSource->startOffset());
+        table->ensureNumericColumns(columns, control);
+        if (control && control->isCancelled())
+            return QSharedPointer<CsvTable>();
+        return table;
+    }
+
+    table.reset(new CsvTable);
+    if (!table->load(filePath, columns, control))
+        return QSharedPointer<CsvTable>();
+
+    // 顺便清理已失效的登记项
+    QMutexLocker locker(&tableRegistryMutex());
+    for (auto it = tableRegistry().begin(); it != tableRegistry().end();) {
+        if (it.value().isNull())
+            it = tableRegistry().erase(it);
+        else
+            ++it;
+    }
+    tableRegistry().insert(key, table);
+    return table;
+}
+
+bool CsvTable::load(const QString& filePath, const QVector<int>& columns, CsvLoadControl* control)
+{
+    QFileInfo info(filePath);
+    mFilePath = filePath;
+    mFileSize = info.size();
+    mLastModified = info.lastModified();
+    if (!mSource->open(filePath))
+        return false;
+
+    // 文件未变化时直接读取上次解析结果的缓存
+    const qint64 dataSize = mSource->size() - mSource->startOffset();
+    if (control)
+        control->setTotal(dataSize);
+    CsvCacheData cached;
+    if (CsvCache::read(filePath, *mSource, mFileSize, mLastModified.toMSecsSinceEpoch(), cached)) {
+        // 行偏移和缓存的列直接引用缓存文件的映射，只有请求了缓存中没有的列时才扫描源文件
+        mCacheMapping = cached.mapping;
+        mRowOffsets = cached.rowOffsets;
+        mColumnCount = cached.columnCount;
+        mNumericColumns = cached.columns;
+        if (ensureNumericColumns(columns, control))
+            writeCache(control);
+        else if (control)
+            control->addProgress(dataSize);
+        return !(control && control->isCancelled());
+    }
+
+    // 一次扫描建立行索引并解析请求的列，其余列在首次使用时再解析
+    QVector<int> requested;
+    for (int column : columns) {
+        if (column >= 0 && !requested.contains(column))
+            requested.append(column);
+    }
+    if (!parseColumns(requested, true, control))
+        return false;
+    writeCache(control);
+    return !(control && control->isCancelled());
+}
+
+void CsvTable::writeCache(CsvLoadControl* control)
+{
+    CsvCache::write(mFilePath, *mSource, mFileSize, mLastModified.toMSecsSinceEpoch(),
+                    mRowOffsets, mColumnCount, mNumericColumns, control);
+}
+
+void CsvTable::release()
+{
+    QMutexLocker locker(&mDataMutex);
+    mSource->close();
+}
+
+bool CsvTable::ensureNumericColumns(const QVector<int>& columns, CsvLoadControl* control)
+{
+    QMutexLocker locker(&mDataMutex);
+    if (!isOpen())
+        return false;
+
+    QVector<int> missing;
+    for (int column : columns) {
+        if (column >= 0 && column < mColumnCount && !hasNumericColumn(column) && !missing.contains(column))
+            missing.append(column);
+    }
+    if (missing.isEmpty())
+        return false;
+    return parseColumns(missing, false, control);
+}
+
+bool CsvTable::hasNumericColumn(int column) const
+{
+    return column >= 0 && column < mNumericColumns.size() && mNumericColumns[column].size() == rowCount();
+}
+
+const QVector<double>& CsvTable::numericColumn(int column) const
+{
+    static const QVector<double> empty;
+    return (column >= 0 && column < mNumericColumns.size()) ? mNumericColumns[column] : empty;
+}
+
+bool CsvTable::parseColumns(const QVector<int>& columns, bool buildRowIndex, CsvLoadControl* control)
+{
+    const CsvFile& file = *mSource;
+    const qint64 dataSize = file.size() - file.startOffset();
+    int chunkCount = dataSize < kParallelThreshold
+            ? 1
+            : int(qMin<qint64>(dataSize / kMinChunkSize, qint64(QThread::idealThreadCount()) * 4));
+
+    // 切块：首次加载时按字节切分并同步到行首；已有行索引时直接按行数切分
+    QVector<qint64> boundaries;
+    if (buildRowIndex) {
+        boundaries = CsvLoader::findChunkBoundaries(file, chunkCount);
+    } else {
+        chunkCount = qMax(1, qMin(chunkCount, rowCount()));
+        boundaries.resize(chunkCount + 1);
+        for (int i = 0; i < chunkCount; ++i) {
+            int row = int(qint64(rowCount()) * i / chunkCount);
+            boundaries[i] = row < rowCount() ? mRowOffsets[row] : file.size();
+        }
+        boundaries[chunkCount] = file.size();
+    }
+
+    QVector<ChunkData> chunks(chunkCount);
+    for (int i = 0; i < chunkCount; ++i) {
+        chunks[i].begin = boundaries[i];
+        chunks[i].end = boundaries[i + 1];
+    }
+
+    auto parse = [&](ChunkData& chunk) {
+        if (buildRowIndex)
+            parseChunkRowIndex(file, columns, chunk, control);
+        else
+            parseChunkColumns(file, columns, chunk, control);
+    };
+    if (chunkCount == 1)
+        parse(chunks[0]);
+    else
+        QtConcurrent::blockingMap(chunks, parse);
+    if (control && control->isCancelled())
+        return false;
+
+    // 按原始行顺序拼接
+    if (buildRowIndex) {
+        int totalRows = 0;
+        mColumnCount = 0;
+        for (const ChunkData& chunk : chunks) {
+            totalRows += chunk.rowCount;
+            mColumnCount = qMax(mColumnCount, chunk.fieldCount);
+        }
+        mRowOffsets.clear();
+        mRowOffsets.reserve(totalRows);
+        for (ChunkData& chunk : chunks) {
+            mRowOffsets += chunk.rowOffsets;
+            chunk.rowOffsets = QVector<qint64>();
+        }
+
+        // 预先分配所有列，之后补充解析时不再移动已有的列
+        mNumericColumns.clear();
+        mNumericColumns.resize(mColumnCount);
+    }
+
+    for (int i = 0; i < columns.size(); ++i) {
+        QVector<double> values;
+        values.reserve(rowCount());
+        for (ChunkData& chunk : chunks) {
+            values += chunk.columns[i];
+            chunk.columns[i] = QVector<double>();  // 尽早释放分块数据
+        }
+
+        // 超出最宽一行的列没有数据，不保存
+        int column = columns[i];
+        if (column < mNumericColumns.size())
+            mNumericColumns[column] = values;
+    }
+    return true;
+}
+
+void CsvTable::readRows(CsvReader& reader, int firstRow, int lastRow) const
+{
+    qint64 end = lastRow < rowCount() ? mRowOffsets[lastRow] : mSource->size();
+    reader.setRange(mRowOffsets[firstRow], end);
+}
+
+const CsvTableProfile& CsvTable::profile()
+{
+    // 概况计算后不再改变，之后的调用不必等待正在追加数据或补充解析的线程
+    if (mHasProfile.load(std::memory_order_acquire))
+        return mProfile;
+
+    QMutexLocker locker(&mProfileMutex);
+    QMutexLocker dataLocker(&mDataMutex);
+    if (!mHasProfile.load(std::memory_order_relaxed) && isOpen()) {
+        buildProfile();
+        mHasProfile.store(true, std::memory_order_release);
+    }
+    return mProfile;
+}
+
+void CsvTable::buildProfile()
+{
+    mProfile = CsvTableProfile();
+    if (rowCount() == 0)
+        return;
+
+    CsvReader reader(*mSource);
+    CsvField line;
+    QVector<CsvField> fields;
+
+    // 第一行的第一个字段不是数字时视为表头（与原来的判断规则一致）
+    readRows(reader, 0, 1);
+    QStringList header;
+    if (reader.readRow(line, fields) && !fields.isEmpty()) {
+        header = CsvFile::toStringList(fields);
+        bool ok;
+        CsvFile::toDouble(fields[0], &ok);
+        mProfile.hasHeader = !ok && rowCount() > 1;
+    }
+    const int firstDataRow = mProfile.hasHeader ? 1 : 0;
+    const int dataRows = rowCount() - firstDataRow;
+
+    const int columnCount = qMax(mColumnCount, header.size());
+    QVector<ColumnCounter> counters(columnCount);
+
+    // 在整个文件中均匀抽取若干段连续的行；各段按文件顺序读取，相邻值可用于估计单调性
+    int runs = kProfileRuns;
+    int runLength = kProfileRunLength;
+    if (dataRows <= runs * runLength) {
+        runs = 1;
+        runLength = dataRows;
+    }
+    for (int run = 0; run < runs && runLength > 0; ++run) {
+        int first = firstDataRow + int(qint64(dataRows - runLength) * run / qMax(1, runs - 1));
+        readRows(reader, first, first + runLength);
+        while (reader.readRow(line, fields)) {
+            if (line.trimmed().isEmpty())
+                continue;  // 空行不参与统计
+            mProfile.sampledRows++;
+            for (int column = 0; column < columnCount; ++column) {
+                ColumnCounter& counter = counters[column];
+                if (column >= fields.size() || fields[column].trimmed().isEmpty()) {
+                    counter.empty++;
+                    continue;
+                }
+                bool ok;
+                double value = CsvFile::toDouble(fields[column], &ok);
+                if (ok)
+                    counter.numeric++;
+                if (ok && qIsFinite(value))
+                    counter.add(value);
+                else
+                    counter.nan++;
+            }
+        }
+    }
+
+    mProfile.columns.resize(columnCount);
+    for (int column = 0; column < columnCount; ++column) {
+        const ColumnCounter& sample = counters[column];
+        CsvColumnProfile& profile = mProfile.columns[column];
+        if (mProfile.hasHeader && column < header.size())
+            profile.name = header[column].trimmed();
+
+        const int sampled = mProfile.sampledRows;
+        const int text = sampled - sample.empty - sample.numeric;
+        if (sample.numeric == 0)
+            profile.type = text > 0 ? CsvColumnProfile::Text : CsvColumnProfile::Empty;
+        else
+            profile.type = text > 0 ? CsvColumnProfile::Mixed : CsvColumnProfile::Numeric;
+        if (sampled > 0) {
+            profile.emptyRatio = double(sample.empty) / sampled;
+            profile.nanRatio = double(sample.nan) / sampled;
+        }
+
+        // 已缓存的数值列按整列统计范围和单调性，否则使用抽样结果
+        ColumnCounter whole;
+        if (hasNumericColumn(column)) {
+            const QVector<double>& values = mNumericColumns[column];
+            for (int row = firstDataRow; row < values.size(); ++row) {
+                if (qIsFinite(values[row]))  // 缺失值同样是 NaN
+                    whole.add(values[row]);
+            }
+        }
+        const ColumnCounter& range = hasNumericColumn(column) ? whole : sample;
+        if (range.minimum <= range.maximum) {
+            profile.minimum = range.minimum;
+            profile.maximum = range.maximum;
+        }
+        profile.order = range.order();
+    }
+}
+
+bool CsvTable::appendFromFile(int& firstChangedRow)
+{
+    firstChangedRow = rowCount();
+    QFileInfo info(mFilePath);
+    const qint64 newSize = info.size();
+    if (!isOpen() || newSize < mFileSize)
+        return false;
+    if (newSize == mFileSize)
+        return true;
+
+    QMutexLocker locker(&mDataMutex);
+
+    // 原来的最后一行没有以换行符结束时可能还没写完，去掉后重新解析
+    const CsvFile& file = *mSource;
+    qint64 resume = file.size();
+    if (!mRowOffsets.isEmpty() && file.size() > 0 && file.data()[file.size() - 1] != '\n') {
+        resume = mRowOffsets.last();
+        mRowOffsets.removeLast();
+        for (QVector<double>& values : mNumericColumns) {
+            if (values.size() > rowCount())
+                values.removeLast();
+        }
+    }
+    firstChangedRow = rowCount();
+
+    // 已缓存的列继续逐行追加，其余列保持未解析
+    QVector<int> cached;
+    for (int column = 0; column < mNumericColumns.size(); ++column) {
+        if (mNumericColumns[column].size() == rowCount())
+            cached.append(column);
+    }
+
+    if (!mSource->open(mFilePath))
+        return false;
+    mFileSize = mSource->size();  // 映射的大小即已解析到的位置
+    mLastModified = info.lastModified();
+
+    CsvReader reader(*mSource);
+    reader.setRange(qMax(resume, mSource->startOffset()), mSource->size());
+    CsvField line;
+    QVector<CsvField> fields;
+    while (reader.readRow(line, fields)) {
+        mRowOffsets.append(reader.rowOffset());
+        mColumnCount = qMax(mColumnCount, fields.size());
+        for (int column : cached)
+            mNumericColumns[column].append(parseCell(fields, column));
+    }
+    if (mNumericColumns.size() < mColumnCount)
+        mNumericColumns.resize(mColumnCount);
+    return true;
+}
+
+int CsvTable::fieldCount(int row) const
+{
+    QMutexLocker locker(&mDataMutex);  // 追加新行时会重新映射文件
+    if (row < 0 || row >= rowCount() || !isOpen())
+        return 0;
+    CsvReader reader(*mSource);
+    readRows(reader, row, row + 1);
+    CsvField line;
+    QVector<CsvField> fields;
+    return reader.readRow(line, fields) ? fields.size() : 0;
+}
+
+QStringList CsvTable::rowFields(int row) const
+{
+    QMutexLocker locker(&mDataMutex);  // 追加新行时会重新映射文件
+    if (row < 0 || row >= rowCount() || !isOpen())
+        return QStringList();
+    CsvReader reader(*mSource);
+    readRows(reader, row, row + 1);
+    CsvField line;
+    QVector<CsvField> fields;
+    if (!reader.readRow(line, fields))
+        return QStringList();
+    return CsvFile::toStringList(fields);
+}
+
+QString CsvTable::text(int row, int column) const
+{
+    QMutexLocker locker(&mDataMutex);  // 追加新行时会重新映射文件
+    if (row < 0 || row >= rowCount() || !isOpen())
+        return QString();
+    CsvReader reader(*mSource);
+    readRows(reader, row, row + 1);
+    CsvField line;
+    QVector<CsvField> fields;
+    if (!reader.readRow(line, fields) || column < 0 || column >= fields.size())
+        return QString();
+    return fields[column].toString();
+}
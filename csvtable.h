@@ -0,0 +1,124 @@
+#ifndef CSVTABLE_H
+#define CSVTABLE_H
+
+#include <QDateTime>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include "csvfile.h"
+
+// 后台解析（或保存）的进度与取消标志：工作线程更新，界面线程轮询
+class CsvLoadControl
+{
+public:
+    CsvLoadControl() : mCancelled(false), mProcessed(0), mTotal(0) {}
+
+    void cancel() { mCancelled = true; }
+    bool isCancelled() const { return mCancelled; }
+
+    void setTotal(qint64 bytes) { mTotal = bytes; }
+    void addProgress(qint64 bytes) { mProcessed += bytes; }
+    qint64 processed() const { return mProcessed; }
+    qint64 total() const { return mTotal; }
+
+private:
+    std::atomic<bool> mCancelled;
+    std::atomic<qint64> mProcessed;
+    std::atomic<qint64> mTotal;
+};
+
+// 一列数据的概况（由抽样统计，用于列选择下拉框）
+struct CsvColumnProfile {
+    enum Type { Empty, Numeric, Text, Mixed };  // Mixed：数字中夹杂少量文本
+    enum Order { Unordered, Increasing, Decreasing };
+
+    QString name;  // 表头中的列名，无表头时为空
+    Type type = Empty;
+    double emptyRatio = 0;  // 抽样中空单元格的比例
+    double nanRatio = 0;  // 抽样中非空但不是有限数字（文本、nan、inf）的比例
+    double minimum = 0;  // 有限数值的范围（已缓存的数值列按整列统计）
+    double maximum = 0;
+    Order order = Unordered;  // 单调性（忽略无效值）
+};
+
+struct CsvTableProfile {
+    bool hasHeader = false;
+    int sampledRows = 0;
+    QVector<CsvColumnProfile> columns;
+};
+
+// 按列存储的CSV表格，同一文件的所有曲线共享一份
+// 打开时一次扫描建立行索引并解析请求的列（每个单元格一个 double），其余列在首次使用时再一次性解析，
+// 宽文件只为实际使用的列占用内存；文本不保存副本，需要时从文件映射中解码
+class CsvTable
+{
+public:
+    ~CsvTable();
+
+    // 取得文件对应的共享表格（文件未变化时复用已打开的表格），并确保 columns 中的数值列已解析
+    // （复用的表格中尚未解析的列此时再一次性补充解析）。
+    // 可在工作线程中调用；control 用于汇报进度，被取消时返回空指针
+    static QSharedPointer<CsvTable> open(const QString& filePath, const QVector<int>& columns = QVector<int>(),
+                                         CsvLoadControl* control = nullptr);
+    // 不是数字（或该行没有这一列）的单元格的取值
+    static double missingValue();
+    static bool isMissing(double value);
+
+    QString filePath() const { return mFilePath; }
+    bool isOpen() const { return mSource->isOpen(); }
+    const CsvFile& source() const { return *mSource; }
+    void release();  // 释放文件映射（覆盖保存源文件前调用）
+    // 行索引、数值列和文件映射的锁；读取 numericColumn() 等数据期间持有，防止被并发追加或补充解析修改
+    QMutex* dataMutex() const { return &mDataMutex; }
+
+    // 文件在末尾追加了数据时重新映射并只解析新增的部分，firstChangedRow 返回第一个新增（或重新解析）的行；
+    // 原来末尾没有换行符的行视为未写完，会被重新解析。文件被截断或无法重新打开时返回 false
+    bool appendFromFile(int& firstChangedRow);
+
+    int rowCount() const { return mRowOffsets.size(); }  // 文件中的全部行，包括表头和空行
+    int columnCount() const { return mColumnCount; }  // 最宽一行的字段数
+    qint64 rowOffset(int row) const { return mRowOffsets[row]; }
+
+    // 一次扫描解析所有尚未缓存的列（超出 columnCount() 的列忽略），解析了新的列时返回 true；
+    // 需要扫描整个文件，界面线程中只应在 hasNumericColumn 为 true 时调用。control 被取消时不保存任何列并返回 false
+    bool ensureNumericColumns(const QVector<int>& columns, CsvLoadControl* control = nullptr);
+    bool hasNumericColumn(int column) const;
+    // 每行一个值，无效单元格为 missingValue()；须先调用 ensureNumericColumns
+    const QVector<double>& numericColumn(int column) const;
+
+    // 各列概况，首次调用时在整个文件中均匀抽样计算并缓存；之后直接返回，不再加锁
+    const CsvTableProfile& profile();
+
+    // 文本按需解码；自行持有 dataMutex()，调用时不能已持有该锁
+    int fieldCount(int row) const;
+    QStringList rowFields(int row) const;
+    QString text(int row, int column) const;
+
+private:
+    CsvTable();
+    bool load(const QString& filePath, const QVector<int>& columns, CsvLoadControl* control);
+    // 解析 columns 中的列，buildRowIndex 为 true 时同时建立行索引；被取消时返回 false
+    bool parseColumns(const QVector<int>& columns, bool buildRowIndex, CsvLoadControl* control = nullptr);
+    // 读取 [firstRow, lastRow) 之间的行时只扫描这部分数据
+    void readRows(CsvReader& reader, int firstRow, int lastRow) const;
+    void buildProfile();
+    // 把行索引和已解析的列写入磁盘缓存（在加载线程中调用，control 被取消时放弃）
+    void writeCache(CsvLoadControl* control);
+
+    QString mFilePath;
+    qint64 mFileSize;
+    QDateTime mLastModified;
+    QSharedPointer<CsvFile> mSource;
+    QSharedPointer<QFile> mCacheMapping;  // 数据来自磁盘缓存时（Qt 6），行偏移和缓存的列引用这一映射
+    QVector<qint64> mRowOffsets;  // 每行在文件中的起始偏移
+    QVector<QVector<double>> mNumericColumns;  // 未解析的列为空
+    int mColumnCount;
+    mutable QMutex mDataMutex;  // 保护行索引、数值列和文件映射（后台线程补充解析列、界面线程追加新行）
+    QMutex mProfileMutex;  // 只在首次计算概况时加锁
+    std::atomic<bool> mHasProfile;
+    CsvTableProfile mProfile;
+};
+
+#endif // CSVTABLE_H
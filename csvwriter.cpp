@@ -0,0 +1,88 @@
+#include "csvwriter.h"
+#include "csvnumber.h"
+#include <algorithm>
+
+namespace {
+
+// 原样复制时每次写出的最大字节数（进度和取消的粒度）
+const qint64 kCopyChunkSize = 4 * 1024 * 1024;
+
+bool copyBytes(QIODevice& out, const char* data, qint64 size, CsvLoadControl* control)
+{
+    while (size > 0) {
+        if (control && control->isCancelled())
+            return false;
+        const qint64 chunk = qMin(size, kCopyChunkSize);
+        if (out.write(data, chunk) != chunk)
+            return false;
+        if (control)
+            control->addProgress(chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace CsvWriter {
+
+QVector<CsvPatch> locateCells(const CsvTable& table, int column, const QVector<int>& rows,
+                              const QVector<double>& values)
+{
+    QVector<CsvPatch> patches;
+    const CsvFile& source = table.source();
+    if (!source.isOpen())
+        return patches;
+
+    // 每个被修改的行只扫描这一行
+    CsvReader reader(source);
+    CsvField line;
+    QVector<CsvField> fields;
+    patches.reserve(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        const int row = rows[i];
+        if (row < 0 || row >= table.rowCount())
+            continue;
+        qint64 rowEnd = row + 1 < table.rowCount() ? table.rowOffset(row + 1) : source.size();
+        reader.setRange(table.rowOffset(row), rowEnd);
+        if (!reader.readRow(line, fields) || column >= fields.size())
+            continue;
+        patches.append({fields[column].data - source.data(), fields[column].size, values[i]});
+    }
+
+    // 数据点按X排序，改为按文件位置排列，使源文件只需顺序写出一遍
+    std::sort(patches.begin(), patches.end(),
+              [](const CsvPatch& a, const CsvPatch& b) { return a.offset < b.offset; });
+    return patches;
+}
+
+bool writePatched(QIODevice& out, const CsvFile& source, const QVector<CsvPatch>& patches,
+                  CsvLoadControl* control)
+{
+    if (!source.isOpen())
+        return false;
+    const char* data = source.data();
+    const qint64 size = source.size();
+    if (control)
+        control->setTotal(size);
+
+    // 把上一处修改之后、单元格之前的字节原样写出，再写出新值
+    char number[CsvNumber::kMaxFormattedSize];
+    qint64 copied = 0;
+    for (const CsvPatch& patch : patches) {
+        if (patch.offset < copied || patch.offset + patch.size > size)
+            continue;  // 位置未排序、重复或超出文件
+        if (!copyBytes(out, data + copied, patch.offset - copied, control))
+            return false;
+        const int length = CsvNumber::formatDouble(patch.value, number);
+        if (out.write(number, length) != length)
+            return false;
+        copied = patch.offset + patch.size;
+        if (control)
+            control->addProgress(patch.size);
+    }
+    return copyBytes(out, data + copied, size - copied, control);
+}
+
+} // namespace CsvWriter
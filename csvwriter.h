@@ -0,0 +1,33 @@
+#ifndef CSVWRITER_H
+#define CSVWRITER_H
+
+#include <QIODevice>
+#include <QVector>
+#include "csvtable.h"
+
+// 要改写的一个单元格
+struct CsvPatch {
+    qint64 offset;  // 单元格在源文件中的起始位置
+    int size;  // 原单元格的字节数
+    double value;
+};
+
+// 保存修改后的CSV：把源文件按原样复制到输出，只重新写出被修改的单元格。
+// 未修改的字节直接从文件映射写出（表头、空行、被过滤的行、其他列和换行符都保持不变），
+// 新值按最短的可往返格式输出，重新读入后与内存中的值完全相同。
+namespace CsvWriter {
+
+// 找出 column 列中 rows 各行单元格的位置（只扫描这些行），返回按位置排列的修改，新值为 values 中对应的值；
+// 行不存在或没有该列时跳过。调用方须持有 table.dataMutex()
+QVector<CsvPatch> locateCells(const CsvTable& table, int column, const QVector<int>& rows,
+                              const QVector<double>& values);
+
+// 把 source 写到 out，并把 patches 所列的单元格替换为新值；patches 须按位置递增排列。
+// source 由调用方另行打开，不与表格共享映射，因此不需要持有表格的锁，可在工作线程中调用；
+// control 按写出的源文件字节数汇报进度，被取消时返回 false
+bool writePatched(QIODevice& out, const CsvFile& source, const QVector<CsvPatch>& patches,
+                  CsvLoadControl* control = nullptr);
+
+} // namespace CsvWriter
+
+#endif // CSVWRITER_H
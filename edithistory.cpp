@@ -0,0 +1,99 @@
+#include "edithistory.h"
+
+EditHistory::EditHistory(qint64 maxBytes)
+    : mHead(0), mCount(0), mUndoCount(0), mBytes(0), mMaxBytes(maxBytes)
+{
+}
+
+qint64 EditHistory::commandBytes(const EditCommand& command)
+{
+    return qint64(sizeof(EditCommand)) + qint64(command.edits.capacity()) * sizeof(PointEdit);
+}
+
+void EditHistory::push(const EditCommand& command)
+{
+    while (mCount > mUndoCount)
+        dropLast();
+    
+    // 缓冲区满时按两倍扩容，把记录重新排到开头
+    if (mCount == mSlots.size()) {
+        QVector<EditCommand> slots(qMax(16, 2 * mSlots.size()));
+        for (int i = 0; i < mCount; ++i)
+            slots[i] = at(i);  // QVector 隐式共享，不复制修改记录
+        mSlots.swap(slots);
+        mHead = 0;
+    }
+    
+    EditCommand& slot = at(mCount);
+    slot = command;
+    slot.edits.squeeze();
+    mBytes += commandBytes(slot);
+    ++mCount;
+    mUndoCount = mCount;
+    
+    // 超过上限时淘汰最早的记录，至少保留刚加入的一条
+    while (mBytes > mMaxBytes && mCount > 1)
+        dropFirst();
+}
+
+void EditHistory::clear()
+{
+    mSlots.clear();
+    mHead = 0;
+    mCount = 0;
+    mUndoCount = 0;
+    mBytes = 0;
+}
+
+void EditHistory::removeGraph(const QCPGraph* graph)
+{
+    // 少见的操作：保留其他曲线的记录，重新排列
+    QVector<EditCommand> kept;
+    int keptUndoCount = 0;
+    for (int i = 0; i < mCount; ++i) {
+        if (at(i).graph == graph)
+            continue;
+        kept.append(at(i));
+        if (i < mUndoCount)
+            ++keptUndoCount;
+    }
+    if (kept.size() == mCount)
+        return;
+    
+    clear();
+    for (const EditCommand& command : kept)
+        mBytes += commandBytes(command);
+    mCount = kept.size();
+    mUndoCount = keptUndoCount;
+    mSlots = kept;
+}
+
+const EditCommand& EditHistory::undo()
+{
+    Q_ASSERT(canUndo());
+    return at(--mUndoCount);
+}
+
+const EditCommand& EditHistory::redo()
+{
+    Q_ASSERT(canRedo());
+    return at(mUndoCount++);
+}
+
+void EditHistory::dropLast()
+{
+    EditCommand& slot = at(mCount - 1);
+    mBytes -= commandBytes(slot);
+    slot = EditCommand();
+    --mCount;
+}
+
+void EditHistory::dropFirst()
+{
+    EditCommand& slot = at(0);
+    mBytes -= commandBytes(slot);
+    slot = EditCommand();
+    mHead = (mHead + 1) % mSlots.size();
+    --mCount;
+    --mUndoCount;
+}
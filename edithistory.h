@@ -0,0 +1,57 @@
+#ifndef EDITHISTORY_H
+#define EDITHISTORY_H
+
+#include <QVector>
+
+class QCPGraph;
+
+// 一个数据点的Y值修改
+struct PointEdit {
+    int index;  // 数据容器中的下标
+    double oldValue;
+    double newValue;
+};
+
+// 一次可撤销的操作：同一条曲线上若干点的修改
+struct EditCommand {
+    QCPGraph* graph = nullptr;  // 所属曲线
+    QVector<PointEdit> edits;
+};
+
+// 撤销/重做记录：只保存被修改的点（下标、旧值、新值），存放在环形缓冲区中，
+// 总大小超过上限时从最早的记录开始淘汰（每次淘汰 O(1)）
+class EditHistory
+{
+public:
+    explicit EditHistory(qint64 maxBytes = 64 * 1024 * 1024);
+
+    // 记录新操作，同时丢弃所有可重做的记录
+    void push(const EditCommand& command);
+    void clear();
+    // 曲线被删除或数据被重新加载（下标失效）时移除与它相关的记录
+    void removeGraph(const QCPGraph* graph);
+
+    bool canUndo() const { return mUndoCount > 0; }
+    bool canRedo() const { return mUndoCount < mCount; }
+    int undoCount() const { return mUndoCount; }
+    qint64 bytes() const { return mBytes; }
+
+    // 返回需要撤销（写回旧值）/重做（写回新值）的操作，并移动当前位置
+    const EditCommand& undo();
+    const EditCommand& redo();
+
+private:
+    EditCommand& at(int i) { return mSlots[(mHead + i) % mSlots.size()]; }
+    static qint64 commandBytes(const EditCommand& command);
+    void dropLast();
+    void dropFirst();
+
+    QVector<EditCommand> mSlots;  // 环形缓冲区
+    int mHead;  // 最早一条记录所在的槽
+    int mCount;  // 记录总数
+    int mUndoCount;  // 前 mUndoCount 条可撤销，其余可重做
+    qint64 mBytes;
+    qint64 mMaxBytes;
+};
+
+#endif // EDITHISTORY_H
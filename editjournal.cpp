@@ -0,0 +1,397 @@
+#include "editjournal.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMap>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[8] = {'C', 'S', 'V', 'E', 'D', 'I', 'T', 'J'};
+const quint32 kVersion = 1;
+
+// 组提交的间隔：一次拖动结束到写入磁盘最多相隔这么久
+const int kCommitInterval = 500;
+
+struct JournalHeader {
+    char magic[8];
+    quint32 version;
+    quint32 headerSize;
+};
+static_assert(sizeof(JournalHeader) == 16, "JournalHeader layout must stay fixed");
+
+// 每条记录：记录头、size 字节的内容、记录头和内容的CRC32
+struct RecordHeader {
+    quint32 size;
+    quint32 type;
+    quint32 curve;  // 曲线编号（会话内唯一）
+};
+static_assert(sizeof(RecordHeader) == 12, "RecordHeader layout must stay fixed");
+
+enum RecordType : quint32 {
+    CurveRecord = 1,  // 内容：X列、Y列（各 qint32）和文件路径（UTF-8）
+    SavedRecord = 2,
+    DiscardRecord = 3,
+    EditRecord = 16  // 加上 EditJournal::Operation，内容为若干 JournalEdit
+};
+
+struct JournalEdit {
+    qint32 row;
+    qint32 reserved;
+    double oldValue;
+    double newValue;
+};
+static_assert(sizeof(JournalEdit) == 24, "JournalEdit layout must stay fixed");
+
+quint32 crc32(const char* data, qint64 size, quint32 crc = 0)
+{
+    static const QVector<quint32> table = []() {
+        QVector<quint32> table(256);
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[int(i)] = c;
+        }
+        return table;
+    }();
+    crc = ~crc;
+    for (qint64 i = 0; i < size; ++i)
+        crc = table[int((crc ^ quint8(data[i])) & 0xFF)] ^ (crc >> 8);
+    return ~crc;
+}
+
+void syncFile(QFile& file)
+{
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    ::fsync(file.handle());
+#endif
+}
+
+// 回放时一条曲线的状态
+struct ReplayCurve {
+    RecoveredCurve curve;
+    QHash<int, int> valueSlots;  // 行号 -> curve.values 中的位置
+    int undoCount = 0;
+};
+
+// 把 edits 的新值（newValues 为 false 时为旧值）记为当前值；第一次出现的行同时记下文件中的值
+void setValues(ReplayCurve& replay, const QVector<PointEdit>& edits, bool newValues)
+{
+    for (const PointEdit& edit : edits) {
+        double from = newValues ? edit.oldValue : edit.newValue;
+        double to = newValues ? edit.newValue : edit.oldValue;
+        auto slot = replay.valueSlots.constFind(edit.index);
+        if (slot == replay.valueSlots.constEnd()) {
+            replay.valueSlots.insert(edit.index, replay.curve.values.size());
+            replay.curve.values.append({edit.index, from, to});
+        } else {
+            replay.curve.values[*slot].newValue = to;
+        }
+    }
+}
+
+void replay(const char* data, qint64 size, QVector<RecoveredCurve>& recovered)
+{
+    JournalHeader header;
+    if (size < qint64(sizeof(header)))
+        return;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion
+            || header.headerSize != sizeof(JournalHeader))
+        return;
+
+    QMap<quint32, ReplayCurve> curves;  // 按编号（即首次记录的顺序）排列
+    qint64 pos = sizeof(JournalHeader);
+    while (size - pos >= qint64(sizeof(RecordHeader) + sizeof(quint32))) {
+        RecordHeader record;
+        std::memcpy(&record, data + pos, sizeof(record));
+        if (record.size > size - pos - sizeof(RecordHeader) - sizeof(quint32))
+            break;  // 写到一半的记录
+        const char* payload = data + pos + sizeof(RecordHeader);
+        quint32 checksum;
+        std::memcpy(&checksum, payload + record.size, sizeof(checksum));
+        if (crc32(data + pos, sizeof(RecordHeader) + record.size) != checksum)
+            break;
+        pos += sizeof(RecordHeader) + record.size + sizeof(quint32);
+
+        if (record.type == CurveRecord) {
+            if (record.size < 2 * sizeof(qint32))
+                break;
+            ReplayCurve curve;
+            qint32 columns[2];
+            std::memcpy(columns, payload, sizeof(columns));
+            curve.curve.xColumn = columns[0];
+            curve.curve.yColumn = columns[1];
+            curve.curve.filePath = QString::fromUtf8(payload + sizeof(columns), int(record.size - sizeof(columns)));
+            curves.insert(record.curve, curve);
+            continue;
+        }
+
+        auto it = curves.find(record.curve);
+        if (it == curves.end())
+            continue;
+        ReplayCurve& curve = *it;
+        if (record.type == SavedRecord) {
+            curve.curve.values.clear();
+            curve.valueSlots.clear();
+            continue;
+        }
+        if (record.type == DiscardRecord) {
+            curves.erase(it);
+            continue;
+        }
+        if (record.type < EditRecord || record.type > EditRecord + EditJournal::Values
+                || record.size % sizeof(JournalEdit) != 0)
+            continue;
+
+        QVector<PointEdit> edits(int(record.size / sizeof(JournalEdit)));
+        for (int i = 0; i < edits.size(); ++i) {
+            JournalEdit edit;
+            std::memcpy(&edit, payload + i * sizeof(JournalEdit), sizeof(edit));
+            edits[i] = {edit.row, edit.oldValue, edit.newValue};
+        }
+
+        QVector<QVector<PointEdit>>& history = curve.curve.history;
+        switch (EditJournal::Operation(record.type - EditRecord)) {
+        case EditJournal::Command:
+            setValues(curve, edits, true);
+            Q_FALLTHROUGH();
+        case EditJournal::History:
+            history.resize(curve.undoCount);  // 丢弃可重做的记录
+            history.append(edits);
+            curve.undoCount = history.size();
+            break;
+        case EditJournal::Undo:
+            setValues(curve, edits, false);
+            if (curve.undoCount > 0)
+                --curve.undoCount;
+            break;
+        case EditJournal::Redo:
+            setValues(curve, edits, true);
+            if (curve.undoCount < history.size())
+                ++curve.undoCount;
+            break;
+        case EditJournal::Values:
+            setValues(curve, edits, true);
+            break;
+        }
+    }
+
+    // 只恢复值与文件不同的曲线；可重做的记录不恢复
+    for (ReplayCurve& curve : curves) {
+        QVector<PointEdit>& values = curve.curve.values;
+        values.erase(std::remove_if(values.begin(), values.end(),
+                                    [](const PointEdit& edit) { return edit.oldValue == edit.newValue; }),
+                     values.end());
+        if (values.isEmpty())
+            continue;
+        curve.curve.history.resize(curve.undoCount);
+        recovered.append(curve.curve);
+    }
+}
+
+} // namespace
+
+EditJournal::EditJournal()
+    : mNextCurveId(1)
+{
+    mCommitTimer.setSingleShot(true);
+    mCommitTimer.setInterval(kCommitInterval);
+    QObject::connect(&mCommitTimer, &QTimer::timeout, &mCommitTimer, [this]() { commit(); });
+}
+
+EditJournal::~EditJournal()
+{
+    close(false);
+}
+
+bool EditJournal::open(const QString& directory)
+{
+    close(false);
+    if (directory.isEmpty() || !QDir().mkpath(directory))
+        return false;
+
+    // 会话日志在整个会话期间加锁，其他实例不会把它当作已结束的日志恢复
+    QString name = QString("%1-%2.journal")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"))
+            .arg(QCoreApplication::applicationPid());
+    QString filePath = QDir(directory).filePath(name);
+    mLock.reset(new QLockFile(filePath + ".lock"));
+    if (!mLock->tryLock(0)) {
+        mLock.reset();
+        return false;
+    }
+
+    mFile.setFileName(filePath);
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        mLock.reset();
+        return false;
+    }
+    JournalHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerSize = sizeof(JournalHeader);
+    mFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    syncFile(mFile);
+    mDirectory = directory;
+    return true;
+}
+
+QVector<RecoveredCurve> EditJournal::recover()
+{
+    QVector<RecoveredCurve> recovered;
+    if (mDirectory.isEmpty())
+        return recovered;
+
+    const QFileInfoList journals = QDir(mDirectory).entryInfoList(QStringList() << "*.journal", QDir::Files, QDir::Name);
+    for (const QFileInfo& info : journals) {
+        QString filePath = info.absoluteFilePath();
+        if (filePath == QFileInfo(mFile).absoluteFilePath() || mRecoveredFiles.contains(filePath))
+            continue;
+        // 拿不到锁说明写日志的程序仍在运行（进程已退出的锁会被当作过期锁清除）
+        QSharedPointer<QLockFile> lock(new QLockFile(filePath + ".lock"));
+        if (!lock->tryLock(0))
+            continue;
+
+        QFile file(filePath);
+        if (file.open(QIODevice::ReadOnly) && file.size() > 0) {
+            const uchar* data = file.map(0, file.size());
+            if (data) {
+                replay(reinterpret_cast<const char*>(data), file.size(), recovered);
+                file.unmap(const_cast<uchar*>(data));
+            }
+        }
+        mRecoveredFiles.append(filePath);
+        mRecoveredLocks.append(lock);
+    }
+    return recovered;
+}
+
+void EditJournal::discardRecovered()
+{
+    // 恢复出的修改可能已经重新记录到本次会话的日志中，先确保写入磁盘
+    writePending();
+    for (const QString& filePath : mRecoveredFiles)
+        QFile::remove(filePath);
+    mRecoveredFiles.clear();
+    mRecoveredLocks.clear();  // 释放并删除锁文件
+}
+
+quint32 EditJournal::curveId(const QCPGraph* graph, const QString& filePath, int xColumn, int yColumn)
+{
+    auto it = mCurveIds.constFind(graph);
+    if (it != mCurveIds.constEnd())
+        return *it;
+
+    quint32 id = mNextCurveId++;
+    mCurveIds.insert(graph, id);
+    QByteArray payload;
+    qint32 columns[2] = {xColumn, yColumn};
+    payload.append(reinterpret_cast<const char*>(columns), sizeof(columns));
+    payload.append(QFileInfo(filePath).absoluteFilePath().toUtf8());
+    append(CurveRecord, id, payload);
+    return id;
+}
+
+void EditJournal::record(Operation operation, const QCPGraph* graph, const QString& filePath, int xColumn, int yColumn,
+                         const QVector<PointEdit>& edits)
+{
+    if (!isOpen() || edits.isEmpty())
+        return;
+
+    quint32 id = curveId(graph, filePath, xColumn, yColumn);
+    QByteArray payload(edits.size() * int(sizeof(JournalEdit)), Qt::Uninitialized);
+    char* out = payload.data();
+    for (const PointEdit& edit : edits) {
+        JournalEdit journalEdit = {edit.index, 0, edit.oldValue, edit.newValue};
+        std::memcpy(out, &journalEdit, sizeof(journalEdit));
+        out += sizeof(journalEdit);
+    }
+    append(EditRecord + operation, id, payload);
+}
+
+void EditJournal::markSaved(const QCPGraph* graph)
+{
+    auto it = mCurveIds.constFind(graph);
+    if (isOpen() && it != mCurveIds.constEnd())
+        append(SavedRecord, *it, QByteArray());
+}
+
+void EditJournal::discard(const QCPGraph* graph)
+{
+    auto it = mCurveIds.find(graph);
+    if (!isOpen() || it == mCurveIds.end())
+        return;
+    append(DiscardRecord, *it, QByteArray());
+    mCurveIds.erase(it);  // 再次修改时重新记录文件和列（可能已改变）
+}
+
+void EditJournal::append(quint32 type, quint32 curve, const QByteArray& payload)
+{
+    RecordHeader header = {quint32(payload.size()), type, curve};
+    const int start = mPending.size();
+    mPending.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    mPending.append(payload);
+    quint32 checksum = crc32(mPending.constData() + start, mPending.size() - start);
+    mPending.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+
+    if (!mCommitTimer.isActive())
+        mCommitTimer.start();
+}
+
+void EditJournal::commit()
+{
+    if (mPending.isEmpty() || !isOpen())
+        return;
+    // 上一次提交尚未完成时把新记录留到下一批
+    if (mCommit.isRunning()) {
+        mCommitTimer.start();
+        return;
+    }
+
+    QByteArray batch;
+    batch.swap(mPending);
+    QFile* file = &mFile;
+    mCommit = QtConcurrent::run([file, batch]() {
+        file->write(batch);
+        syncFile(*file);
+    });
+}
+
+void EditJournal::writePending()
+{
+    mCommitTimer.stop();
+    mCommit.waitForFinished();
+    if (isOpen() && !mPending.isEmpty()) {
+        mFile.write(mPending);
+        syncFile(mFile);
+    }
+    mPending.clear();
+}
+
+void EditJournal::close(bool removeFile)
+{
+    if (!isOpen())
+        return;
+
+    writePending();
+    QString filePath = QFileInfo(mFile).absoluteFilePath();
+    mFile.close();
+    if (removeFile)
+        QFile::remove(filePath);
+    mLock.reset();  // 释放并删除锁文件
+    mCurveIds.clear();
+    mDirectory.clear();
+}
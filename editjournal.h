@@ -0,0 +1,81 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QLockFile>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include "edithistory.h"
+
+// 从之前会话的日志中恢复出的一条曲线（PointEdit::index 均为表格行号，不受排序影响）
+struct RecoveredCurve {
+    QString filePath;
+    int xColumn = 0;
+    int yColumn = 0;
+    QVector<PointEdit> values;  // 未保存的修改：oldValue 为文件中的值，newValue 为修改后的值
+    QVector<QVector<PointEdit>> history;  // 可撤销的操作，从早到晚
+};
+
+// 修改日志：每个会话一个只追加的二进制文件，记录拖动修改、撤销/重做和保存，程序崩溃后下次启动时恢复。
+// 记录先放在内存中，每隔 kCommitInterval 毫秒由工作线程一次写入并同步到磁盘（组提交），
+// 界面线程只做内存追加。每条记录带CRC32校验，回放时在第一条不完整或损坏的记录处停止。
+// 日志中的点以表格行号标识，曲线重新排序或追加行后依然有效
+class EditJournal
+{
+public:
+    enum Operation {
+        Command,  // 新的可撤销操作（值改为 newValue）
+        Undo,  // 撤销（值改回 oldValue）
+        Redo,  // 重做（值改为 newValue）
+        History,  // 只加入撤销记录，不改变值（恢复时使用）
+        Values  // 只改变值（改为 newValue），不加入撤销记录
+    };
+
+    EditJournal();
+    ~EditJournal();  // 写入未提交的记录，保留日志文件
+
+    // 在 directory 中新建本次会话的日志并加锁
+    bool open(const QString& directory);
+    bool isOpen() const { return mFile.isOpen(); }
+    // 读出目录中其他已结束（或崩溃）的会话留下的日志里尚未保存的修改；
+    // 这些日志保持锁定，直到调用 discardRecovered() 删除
+    QVector<RecoveredCurve> recover();
+    void discardRecovered();
+
+    // 记录 graph 上的修改（edits 的 index 为表格行号），首次记录某条曲线时写入它的文件和列
+    void record(Operation operation, const QCPGraph* graph, const QString& filePath, int xColumn, int yColumn,
+                const QVector<PointEdit>& edits);
+    // 曲线的当前值已保存，之前的修改不再需要恢复（撤销记录保留）
+    void markSaved(const QCPGraph* graph);
+    // 曲线被删除或数据从文件重新加载：丢弃它的修改和撤销记录
+    void discard(const QCPGraph* graph);
+
+    // 立即在后台提交已记录的内容
+    void commit();
+    // 等待并写入所有记录后关闭；removeFile 为 true 时删除日志（没有需要恢复的修改）
+    void close(bool removeFile);
+
+private:
+    quint32 curveId(const QCPGraph* graph, const QString& filePath, int xColumn, int yColumn);
+    void append(quint32 type, quint32 curve, const QByteArray& payload);
+    void writePending();  // 在当前线程中同步写入所有记录
+
+    QString mDirectory;
+    QFile mFile;
+    QScopedPointer<QLockFile> mLock;
+    QHash<const QCPGraph*, quint32> mCurveIds;  // 已写入日志的曲线
+    quint32 mNextCurveId;
+    QByteArray mPending;  // 尚未提交的记录
+    QTimer mCommitTimer;
+    QFuture<void> mCommit;  // 正在进行的后台提交
+    QStringList mRecoveredFiles;
+    QList<QSharedPointer<QLockFile>> mRecoveredLocks;
+};
+
+#endif // EDITJOURNAL_H
@@ -6,7 +6,8 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QFile>
-#include <QTextStream>
+#include <QSaveFile>
+#include <QFileInfo>
 #include <QFontDialog>
 #include <QDialog>
 #include <QTextEdit>
@@ -15,11 +16,32 @@
 #include <QFontComboBox>
 #include <QSpinBox>
 #include <QTabWidget>
+#include <QtConcurrent>
+#include <QHash>
+#include <QStandardPaths>
+#include <QStatusBar>
+#include <algorithm>
+#include <limits>
+#include "csvcache.h"
+#include "csvwriter.h"
+
+// 后台加载时先显示的行数
+static const int kPreviewRows = 20000;
+// 跟踪文件末尾时检查文件变化的间隔（同时限制了重绘频率）
+static const int kFollowInterval = 40;
+// 拉点模式下可以抓取数据点的像素距离
+static const double kDragGrabRadius = 30;
+
+// 数据点的值与文件中的值是否相同（文件中的 NaN 与自身不相等，未修改时也要视为相同）
+static bool sameValue(double a, double b)
+{
+    return a == b || (qIsNaN(a) && qIsNaN(b));
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), currentCurveIndex(-1),
       dragModeEnabled(false), isDragging(false), draggedGraph(nullptr), draggedPointIndex(-1),
-      hasAutoRescaled(false)
+      dragStartValue(0), dragLayer(nullptr), dragMarker(nullptr), hasAutoRescaled(false), loadTimer(nullptr), followTimer(nullptr), saveTimer(nullptr)
 {
     // 初始化默认字体
     plotTitleFont = QFont("Microsoft YaHei", 12, QFont::Bold);
@@ -28,8 +50,32 @@ MainWindow::MainWindow(QWidget *parent)
     
     setupUI();
     
+    // 解析过的大文件在缓存目录中保存二进制副本，再次打开时无需重新解析
+    CsvCache::setDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/csv");
+    
+    // 拖动修改同时写入本次会话的修改日志；窗口显示后检查之前的会话是否留下了未保存的修改
+    if (journal.open(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journal"))
+        QTimer::singleShot(0, this, &MainWindow::recoverEdits);
+    
+    // 后台加载进度刷新定时器
+    loadTimer = new QTimer(this);
+    loadTimer->setInterval(100);
+    connect(loadTimer, &QTimer::timeout, this, &MainWindow::onLoadTimer);
+    
+    // 跟踪文件末尾的定时器（有曲线开启跟踪时才运行）
+    followTimer = new QTimer(this);
+    followTimer->setInterval(kFollowInterval);
+    connect(followTimer, &QTimer::timeout, this, &MainWindow::onFollowTimer);
+    
+    // 后台保存进度刷新定时器
+    saveTimer = new QTimer(this);
+    saveTimer->setInterval(100);
+    connect(saveTimer, &QTimer::timeout, this, &MainWindow::updateSaveProgress);
+    
     // 初始化图表属性
     customPlot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom | QCP::iSelectPlottables);
+    // 重绘前在线程池中并行计算所有曲线的像素坐标，多条大曲线时重绘时间随核数减少
+    customPlot->setPlottingHint(QCP::phParallelPreparation, true);
     customPlot->xAxis->setLabel("X轴");
     customPlot->xAxis->setLabelFont(xAxisLabelFont);
     customPlot->yAxis->setLabel("Y轴");
@@ -98,10 +144,44 @@ MainWindow::MainWindow(QWidget *parent)
     // 默认启用X轴反转
     customPlot->xAxis->setRangeReversed(true);
     customPlot->xAxis2->setRangeReversed(true);
+    
+    // 拖动层：位于主图层之上，拥有独立的绘制缓冲。拉点模式下当前曲线和拖动标记放在这一层，
+    // 拖动时只重绘这一层再与其他层的缓冲合成，网格、坐标轴、其他曲线和图例都不重绘
+    customPlot->addLayer("drag", customPlot->layer("main"), QCustomPlot::limAbove);
+    dragLayer = customPlot->layer("drag");
+    dragLayer->setMode(QCPLayer::lmBuffered);
+    dragMarker = customPlot->addGraph();
+    dragMarker->setLayer(dragLayer);
+    dragMarker->removeFromLegend();
+    dragMarker->setSelectable(QCP::stNone);
+    dragMarker->setLineStyle(QCPGraph::lsNone);
+    dragMarker->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, QPen(QColor(255, 87, 34), 2), Qt::NoBrush, 12));
+    dragMarker->setVisible(false);
 }
 
 MainWindow::~MainWindow()
 {
+    // 取消并等待未完成的后台加载
+    for (const QSharedPointer<CurveLoadJob>& job : loadJobs) {
+        job->control.cancel();
+        job->watcher->waitForFinished();
+    }
+    
+    // 等待未完成的保存写完并提交，与正常完成时一样把已写入文件的修改标记为已保存
+    if (saveJob) {
+        saveJob->watcher->waitForFinished();
+        if (saveJob->watcher->result()) {
+            releaseCsvSources(saveJob->fileName);
+            if (saveJob->file.commit())
+                markCurveSaved(*saveJob);
+        }
+    }
+    
+    // 还有未保存的修改（包括尚未写回曲线的恢复数据，它们已记入本次日志）时保留日志，下次启动时可以恢复
+    bool anyModified = !pendingRecovery.isEmpty();
+    for (const CurveData& curve : curves)
+        anyModified = anyModified || curve.modified;
+    journal.close(!anyModified);
 }
 
 void MainWindow::setupUI()
@@ -140,10 +220,21 @@ QWidget* MainWindow::setupLeftPanel()
     connect(btnAddCurve, &QPushButton::clicked, this, &MainWindow::onAddCurve);
     connect(btnDeleteCurve, &QPushButton::clicked, this, &MainWindow::onDeleteCurve);
     
+    // 后台加载进度（仅在加载时显示）
+    loadProgress = new QProgressBar();
+    loadProgress->setRange(0, 1000);
+    loadProgress->setFormat("正在加载 %p%");
+    loadProgress->setVisible(false);
+    btnCancelLoad = new QPushButton("取消加载");
+    btnCancelLoad->setVisible(false);
+    connect(btnCancelLoad, &QPushButton::clicked, this, &MainWindow::onCancelLoad);
+    
     leftLayout->addWidget(lblTitle);
     leftLayout->addWidget(curveList);
     leftLayout->addWidget(btnAddCurve);
     leftLayout->addWidget(btnDeleteCurve);
+    leftLayout->addWidget(loadProgress);
+    leftLayout->addWidget(btnCancelLoad);
     
     return leftWidget;
 }
@@ -151,6 +242,22 @@ QWidget* MainWindow::setupLeftPanel()
 void MainWindow::setupCenterPanel()
 {
     customPlot = new QCustomPlot();
+    
+    // 界面触发的重绘统一经过调度器，每个显示帧最多渲染一次；状态栏显示实际帧率
+    replotScheduler = new ReplotScheduler(customPlot, this);
+    lblFrameRate = new QLabel();
+    statusBar()->addPermanentWidget(lblFrameRate);
+    connect(replotScheduler, &ReplotScheduler::frameRateChanged, this, [this](double framesPerSecond) {
+        lblFrameRate->setText(QString("重绘：%1 帧/秒").arg(framesPerSecond, 0, 'f', 1));
+    });
+    
+    // 后台保存进度（仅在保存时显示）
+    saveProgress = new QProgressBar();
+    saveProgress->setRange(0, 1000);
+    saveProgress->setFormat("正在保存 %p%");
+    saveProgress->setMaximumWidth(200);
+    saveProgress->setVisible(false);
+    statusBar()->addWidget(saveProgress);
 }
 
 void MainWindow::setupRightPanel()
@@ -181,11 +288,13 @@ void MainWindow::setupRightPanel()
     
     cmbXColumn = new QComboBox();
     cmbYColumn = new QComboBox();
+    chkFollowFile = new QCheckBox("实时追加文件新写入的数据");
     
     dataLayout->addRow("曲线名称:", edtCurveName);
     dataLayout->addRow("CSV文件:", csvLayout);
     dataLayout->addRow("X列:", cmbXColumn);
     dataLayout->addRow("Y列:", cmbYColumn);
+    dataLayout->addRow("跟踪文件:", chkFollowFile);
     
     curveTabWidget->addTab(dataTab, "数据源");
     
@@ -490,6 +599,7 @@ void MainWindow::setupRightPanel()
     connect(btnSelectCsv, &QPushButton::clicked, this, &MainWindow::onSelectCsvFile);
     connect(cmbXColumn, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onXColumnChanged);
     connect(cmbYColumn, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onYColumnChanged);
+    connect(chkFollowFile, &QCheckBox::toggled, this, &MainWindow::onFollowFileToggled);
     connect(btnCurveColor, &QPushButton::clicked, this, &MainWindow::onCurveColorChanged);
     connect(cmbLineStyle, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onCurveLineStyleChanged);
     connect(spinLineWidth, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::onCurveLineWidthChanged);
@@ -524,7 +634,7 @@ void MainWindow::setupRightPanel()
         spinXMax->setValue(customPlot->xAxis->range().upper);
         spinYMin->setValue(customPlot->yAxis->range().lower);
         spinYMax->setValue(customPlot->yAxis->range().upper);
-        customPlot->replot();
+        replotScheduler->request();
     });
     
     // 拉点功能信号连接
@@ -546,25 +656,35 @@ void MainWindow::onAddCurve()
     if (fileName.isEmpty())
         return;
     
+    addCurve(fileName, 0, 1);
+    
+    replotScheduler->request();
+    
+    curveList->setCurrentRow(curves.size() - 1);
+}
+
+int MainWindow::addCurve(const QString& filePath, int xColumn, int yColumn)
+{
     CurveData newCurve;
     newCurve.name = QString("曲线 %1").arg(curves.size() + 1);
-    newCurve.csvFilePath = fileName;
-    newCurve.xColumn = 0;
-    newCurve.yColumn = 1;
+    newCurve.csvFilePath = filePath;
+    newCurve.xColumn = xColumn;
+    newCurve.yColumn = yColumn;
     newCurve.color = QColor(Qt::GlobalColor(Qt::blue + (curves.size() % 5)));
     newCurve.lineStyle = Qt::NoPen;  // 默认无线型
     newCurve.lineWidth = 1.0;
     newCurve.scatterShape = QCPScatterStyle::ssDisc;  // 默认实心圆
     newCurve.scatterSize = 6.0;
     newCurve.modified = false;  // 初始未修改
+    newCurve.hasHeader = false;
+    newCurve.followFile = false;
+    newCurve.pendingFollowRow = -1;
     
-    // 尝试加载数据，如果失败也不报错，只是数据为空
-    loadCSV(newCurve.csvFilePath, newCurve.xColumn, newCurve.yColumn, 
-            newCurve.xData, newCurve.yData, newCurve.rawDataLines, 
-            newCurve.hasHeader, newCurve.headerLine);
-    
+    newCurve.data.reset(new QCPGraphDataContainer);
+    newCurve.data->setLodEnabled(true);  // 缩小显示大量数据点时按像素宽度而不是点数采样
+    newCurve.pointIndex.reset(new PointIndex);
     newCurve.graph = customPlot->addGraph();
-    newCurve.graph->setData(newCurve.xData, newCurve.yData);
+    newCurve.graph->setData(newCurve.data);  // 与曲线共享同一个数据容器
     newCurve.graph->setName(newCurve.name);
     newCurve.graph->setPen(QPen(newCurve.color, newCurve.lineWidth, newCurve.lineStyle));
     newCurve.graph->setScatterStyle(QCPScatterStyle(newCurve.scatterShape, newCurve.color, newCurve.color, newCurve.scatterSize));
@@ -574,12 +694,9 @@ void MainWindow::onAddCurve()
     curves.append(newCurve);
     curveList->addItem(newCurve.name);
     
-    // 如果需要则自动调整范围
-    autoRescaleIfNeeded();
-    
-    customPlot->replot();
-    
-    curveList->setCurrentRow(curves.size() - 1);
+    // 在后台加载数据，如果失败也不报错，只是数据为空
+    startCurveLoad(curves.size() - 1);
+    return curves.size() - 1;
 }
 
 void MainWindow::onDeleteCurve()
@@ -587,11 +704,16 @@ void MainWindow::onDeleteCurve()
     if (currentCurveIndex < 0 || currentCurveIndex >= curves.size())
         return;
     
+    cancelCurveLoad(curves[currentCurveIndex].graph);
+    history.removeGraph(curves[currentCurveIndex].graph);
+    journal.discard(curves[currentCurveIndex].graph);
+    pendingRecovery.remove(curves[currentCurveIndex].graph);
     customPlot->removeGraph(curves[currentCurveIndex].graph);
     curves.removeAt(currentCurveIndex);
     delete curveList->takeItem(currentCurveIndex);
+    updateFollowTimer();
     
-    customPlot->replot();
+    replotScheduler->request();
     
     if (curves.isEmpty()) {
         currentCurveIndex = -1;
@@ -603,6 +725,7 @@ void MainWindow::onCurveSelected()
 {
     currentCurveIndex = curveList->currentRow();
     updateCurveProperties();
+    updateDragLayer();
 }
 
 void MainWindow::updateCurveProperties()
@@ -614,6 +737,7 @@ void MainWindow::updateCurveProperties()
     btnSelectCsv->setEnabled(hasSelection);
     cmbXColumn->setEnabled(hasSelection);
     cmbYColumn->setEnabled(hasSelection);
+    chkFollowFile->setEnabled(hasSelection);
     btnCurveColor->setEnabled(hasSelection);
     cmbLineStyle->setEnabled(hasSelection);
     spinLineWidth->setEnabled(hasSelection);
@@ -631,9 +755,11 @@ void MainWindow::updateCurveProperties()
         edtCsvPath->setText(curve.csvFilePath);
         
         // 更新列选择下拉框
-        updateColumnComboBoxes(curve.csvFilePath);
-        cmbXColumn->setCurrentIndex(curve.xColumn);
-        cmbYColumn->setCurrentIndex(curve.yColumn);
+        updateColumnComboBoxes(curve.table, curve.xColumn, curve.yColumn);
+        
+        chkFollowFile->blockSignals(true);
+        chkFollowFile->setChecked(curve.followFile);
+        chkFollowFile->blockSignals(false);
         
         QString colorStyle = QString("background-color: %1;").arg(curve.color.name());
         btnCurveColor->setStyleSheet(colorStyle);
@@ -668,7 +794,7 @@ void MainWindow::onCurveColorChanged()
     QString colorStyle = QString("background-color: %1;").arg(color.name());
     btnCurveColor->setStyleSheet(colorStyle);
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onCurveLineStyleChanged(int index)
@@ -680,7 +806,7 @@ void MainWindow::onCurveLineStyleChanged(int index)
     curves[currentCurveIndex].lineStyle = style;
     curves[currentCurveIndex].graph->setPen(QPen(curves[currentCurveIndex].color, curves[currentCurveIndex].lineWidth, style));
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onCurveLineWidthChanged(double value)
@@ -691,7 +817,7 @@ void MainWindow::onCurveLineWidthChanged(double value)
     curves[currentCurveIndex].lineWidth = value;
     curves[currentCurveIndex].graph->setPen(QPen(curves[currentCurveIndex].color, value, curves[currentCurveIndex].lineStyle));
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onCurveScatterShapeChanged(int index)
@@ -703,7 +829,7 @@ void MainWindow::onCurveScatterShapeChanged(int index)
     curves[currentCurveIndex].scatterShape = shape;
     curves[currentCurveIndex].graph->setScatterStyle(QCPScatterStyle(shape, curves[currentCurveIndex].color, curves[currentCurveIndex].color, curves[currentCurveIndex].scatterSize));
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onCurveScatterSizeChanged(double value)
@@ -714,7 +840,7 @@ void MainWindow::onCurveScatterSizeChanged(double value)
     curves[currentCurveIndex].scatterSize = value;
     curves[currentCurveIndex].graph->setScatterStyle(QCPScatterStyle(curves[currentCurveIndex].scatterShape, curves[currentCurveIndex].color, curves[currentCurveIndex].color, value));
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onCurveNameChanged()
@@ -731,7 +857,7 @@ void MainWindow::onCurveNameChanged()
     // 同步更新图表图例
     curves[currentCurveIndex].graph->setName(newName);
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onSelectCsvFile()
@@ -746,23 +872,12 @@ void MainWindow::onSelectCsvFile()
     curves[currentCurveIndex].csvFilePath = fileName;
     edtCsvPath->setText(fileName);
     
-    // 更新列选择下拉框
-    updateColumnComboBoxes(fileName);
-    
-    // 同步更新列索引（防止超出范围）
-    curves[currentCurveIndex].xColumn = cmbXColumn->currentIndex();
-    curves[currentCurveIndex].yColumn = cmbYColumn->currentIndex();
-    
-    // 自动重新加载数据（失败也不报错，只是清空数据）
-    CurveData& curve = curves[currentCurveIndex];
-    loadCSV(curve.csvFilePath, curve.xColumn, curve.yColumn, curve.xData, curve.yData,
-            curve.rawDataLines, curve.hasHeader, curve.headerLine);
-    curve.graph->setData(curve.xData, curve.yData);
-    
-    // 如果需要则自动调整范围
-    autoRescaleIfNeeded();
-    
-    customPlot->replot();
+    // 在后台重新加载数据（失败也不报错，只是清空数据）；
+    // 不使用已缓存的表格，由登记表检查文件是否变化。
+    // 列选择下拉框在加载完成后按新文件的列更新
+    startCurveLoad(currentCurveIndex);
+    updateColumnComboBoxes(QSharedPointer<CsvTable>(), -1, -1);
+    replotScheduler->request();
 }
 
 void MainWindow::onXColumnChanged(int value)
@@ -771,17 +886,7 @@ void MainWindow::onXColumnChanged(int value)
         return;
     
     curves[currentCurveIndex].xColumn = cmbXColumn->currentIndex();
-    
-    // 自动重新加载数据（失败也不报错，只是清空数据）
-    CurveData& curve = curves[currentCurveIndex];
-    loadCSV(curve.csvFilePath, curve.xColumn, curve.yColumn, curve.xData, curve.yData,
-            curve.rawDataLines, curve.hasHeader, curve.headerLine);
-    curve.graph->setData(curve.xData, curve.yData);
-    
-    // 如果需要则自动调整范围
-    autoRescaleIfNeeded();
-    
-    customPlot->replot();
+    reloadCurveColumns(currentCurveIndex);
 }
 
 void MainWindow::onYColumnChanged(int value)
@@ -790,24 +895,48 @@ void MainWindow::onYColumnChanged(int value)
         return;
     
     curves[currentCurveIndex].yColumn = cmbYColumn->currentIndex();
-    
+    reloadCurveColumns(currentCurveIndex);
+}
+
+void MainWindow::reloadCurveColumns(int curveIndex)
+{
     // 自动重新加载数据（失败也不报错，只是清空数据）
-    CurveData& curve = curves[currentCurveIndex];
-    loadCSV(curve.csvFilePath, curve.xColumn, curve.yColumn, curve.xData, curve.yData,
-            curve.rawDataLines, curve.hasHeader, curve.headerLine);
-    curve.graph->setData(curve.xData, curve.yData);
+    CurveData& curve = curves[curveIndex];
+    bool cached = false;
+    if (curve.table) {
+        // 后台正在补充解析这个表格时不等待，按未解析处理
+        QMutex* mutex = curve.table->dataMutex();
+        if (mutex->tryLock()) {
+            cached = curve.table->hasNumericColumn(curve.xColumn) && curve.table->hasNumericColumn(curve.yColumn);
+            mutex->unlock();
+        }
+    }
+    if (!cached) {
+        // 表格尚未就绪（仍在加载或加载失败），或新的列还没有解析过（需要扫描整个文件）：
+        // 在后台加载，显示进度并可以取消
+        startCurveLoad(curveIndex);
+        replotScheduler->request();
+        return;
+    }
+    // 两列都已解析：直接从表格中取出，不读文件
+    loadCSV(curve.csvFilePath, curve.xColumn, curve.yColumn, *curve.data,
+            curve.table, curve.rows, curve.hasHeader, curve.headerLine);
+    curve.pendingFollowRow = -1;  // 已包含表格中的全部行
+    history.removeGraph(curve.graph);  // 数据点已重新排列
+    journal.discard(curve.graph);  // 未保存的修改随之丢弃
+    updateDragControls();
     
     // 如果需要则自动调整范围
     autoRescaleIfNeeded();
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 bool MainWindow::hasAnyValidData()
 {
     // 检查所有曲线是否至少有一条有有效数据
     for (const CurveData& curve : curves) {
-        if (!curve.xData.isEmpty() && !curve.yData.isEmpty()) {
+        if (!curve.data->isEmpty()) {
             return true;
         }
     }
@@ -842,120 +971,439 @@ void MainWindow::autoRescaleIfNeeded()
     hasAutoRescaled = true;
 }
 
-bool MainWindow::loadCSV(const QString& filePath, int xCol, int yCol, QVector<double>& xData, QVector<double>& yData,
-                         QVector<QStringList>& rawData, bool& hasHeader, QStringList& header)
+bool MainWindow::loadCSV(const QString& filePath, int xCol, int yCol, QCPGraphDataContainer& data,
+                         QSharedPointer<CsvTable>& table, QVector<int>& rows, bool& hasHeader, QStringList& header,
+                         bool showWarning)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    // 检查是否为对数X轴
+    bool isLogX = (customPlot->xAxis->scaleType() == QCPAxis::stLogarithmic);
+    
+    // 同一文件已解析过时直接从缓存的列中取数据（切换X/Y列不读文件），
+    // 否则打开共享表格，大文件自动分块多线程解析
+    CsvLoadResult result;
+    bool cached = table && table->isOpen() && table->filePath() == filePath;
+    bool loaded = cached ? CsvLoader::extract(table, xCol, yCol, isLogX, result)
+                         : CsvLoader::load(filePath, xCol, yCol, isLogX, result);
+    if (!loaded && !result.table)
         return false;
     
-    xData.clear();
-    yData.clear();
-    rawData.clear();
-    header.clear();
-    hasHeader = false;
+    // 数据点已按X排序，容器直接接管（不再复制和排序）
+    data.set(result.points, true);
+    table = result.table;
+    rows = result.rows;
+    hasHeader = result.hasHeader;
+    header = result.header;
     
-    QTextStream in(&file);
-    int lineNumber = 0;
-    int skippedLines = 0;
-    int validDataLines = 0;
-    int filteredLogPoints = 0;  // 记录因对数坐标轴被过滤的点数
-    bool firstLineIsHeader = false;
+    // 如果有被过滤的对数坐标点，显示提示
+    if (showWarning)
+        showLogFilterWarning(result);
     
-    // 检查是否为对数X轴
-    bool isLogX = (customPlot->xAxis->scaleType() == QCPAxis::stLogarithmic);
+    return !data.isEmpty();
+}
+
+void MainWindow::showLogFilterWarning(const CsvLoadResult& result)
+{
+    if (result.filteredLogPoints > 0) {
+        QMessageBox::warning(nullptr, "对数坐标轴数据过滤", 
+            QString("对数X轴下检测到 %1 个 X≤0 的数据点。\n\n"
+                    "这些点无法在对数坐标轴上显示，已自动过滤。\n\n"
+                    "有效数据点：%2").arg(result.filteredLogPoints).arg(result.validDataLines));
+    }
+}
+
+void MainWindow::startCurveLoad(int curveIndex, bool keepData)
+{
+    CurveData& curve = curves[curveIndex];
     
-    // 读取第一行判断是否为表头
-    if (!in.atEnd()) {
-        QString firstLine = in.readLine();
-        lineNumber++;
-        QStringList parts = firstLine.split(',');
-        
-        if (parts.size() > qMax(xCol, yCol)) {
-            // 检查第一行是否为数字
-            bool okX, okY;
-            parts[xCol].trimmed().toDouble(&okX);
-            parts[yCol].trimmed().toDouble(&okY);
-            
-            if (!okX || !okY) {
-                // 第一行不是数字，可能是表头
-                firstLineIsHeader = true;
-                hasHeader = true;
-                header = parts;
-                skippedLines++;
-            } else {
-                // 第一行就是数据
-                double x = parts[xCol].trimmed().toDouble();
-                double y = parts[yCol].trimmed().toDouble();
-                
-                // 对数坐标轴下X必须>0
-                if (isLogX && x <= 0) {
-                    filteredLogPoints++;
-                    skippedLines++;
-                } else {
-                    xData.append(x);
-                    yData.append(y);
-                    rawData.append(parts);  // 保存原始数据
-                    validDataLines++;
-                }
-            }
-        } else {
-            skippedLines++;
+    // 同样的加载已在进行中（例如刷新属性面板时重复触发列变化）
+    for (const QSharedPointer<CurveLoadJob>& job : loadJobs) {
+        if (job->graph == curve.graph && !job->control.isCancelled() && job->filePath == curve.csvFilePath
+                && job->xColumn == curve.xColumn && job->yColumn == curve.yColumn && job->keepData == keepData)
+            return;
+    }
+    cancelCurveLoad(curve.graph);
+    
+    QSharedPointer<CsvTable> table;
+    if (curve.table && curve.table->filePath() == curve.csvFilePath)
+        table = curve.table;
+    
+    // 加载完成前曲线没有可编辑的数据（保留数据时只是暂时不能拖动）
+    if (!keepData) {
+        history.removeGraph(curve.graph);
+        journal.discard(curve.graph);
+        pendingRecovery.remove(curve.graph);
+        curve.data->clear();
+        curve.rows.clear();
+    }
+    curve.table.clear();
+    curve.pendingFollowRow = -1;
+    
+    QSharedPointer<CurveLoadJob> job(new CurveLoadJob);
+    job->graph = curve.graph;
+    job->filePath = curve.csvFilePath;
+    job->xColumn = curve.xColumn;
+    job->yColumn = curve.yColumn;
+    job->table = table;
+    job->keepData = keepData;
+    job->watcher = new QFutureWatcher<CsvLoadResult>(this);
+    connect(job->watcher, &QFutureWatcherBase::finished, this, [this, job]() { finishCurveLoad(job); });
+    
+    QString filePath = job->filePath;
+    int xCol = job->xColumn;
+    int yCol = job->yColumn;
+    bool isLogX = (customPlot->xAxis->scaleType() == QCPAxis::stLogarithmic);
+    job->watcher->setFuture(QtConcurrent::run([job, filePath, xCol, yCol, isLogX, keepData]() {
+        // 先读取开头的若干行供界面提前显示（保留数据时不需要），再解析整个文件
+        CsvLoadResult preview;
+        if (!keepData && CsvLoader::preview(filePath, xCol, yCol, isLogX, kPreviewRows, preview)) {
+            QMutexLocker locker(&job->previewMutex);
+            job->preview = preview;
+            job->previewReady = true;
         }
+        CsvLoadResult result;
+        CsvLoader::load(filePath, xCol, yCol, isLogX, result, &job->control);
+        if (result.table)
+            result.table->profile();  // 顺便统计列概况，界面线程直接使用
+        return result;
+    }));
+    
+    loadJobs.append(job);
+    updateLoadProgress();
+    loadTimer->start();
+}
+
+void MainWindow::cancelCurveLoad(QCPGraph* graph)
+{
+    for (const QSharedPointer<CurveLoadJob>& job : loadJobs) {
+        if (job->graph == graph)
+            job->control.cancel();  // 完成时被忽略
     }
-    
-    // 读取剩余数据行
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        lineNumber++;
-        
-        // 跳过空行
-        if (line.trimmed().isEmpty()) {
-            skippedLines++;
+}
+
+void MainWindow::onCancelLoad()
+{
+    for (const QSharedPointer<CurveLoadJob>& job : loadJobs) {
+        if (job->control.isCancelled())
             continue;
-        }
-        
-        QStringList parts = line.split(',');
+        job->control.cancel();
         
-        // 检查列索引是否有效
-        if (parts.size() <= qMax(xCol, yCol)) {
-            skippedLines++;
+        // 被取消的曲线与加载失败一样保持为空（保留数据的重新加载除外）
+        int index = curveIndexOf(job->graph);
+        if (index >= 0 && !job->keepData)
+            curves[index].graph->data()->clear();
+    }
+    replotScheduler->request();
+}
+
+void MainWindow::onLoadTimer()
+{
+    // 显示已经读取到的开头部分
+    bool shown = false;
+    for (const QSharedPointer<CurveLoadJob>& job : loadJobs) {
+        if (job->previewShown || job->control.isCancelled())
             continue;
+        
+        CsvLoadResult preview;
+        {
+            QMutexLocker locker(&job->previewMutex);
+            if (!job->previewReady)
+                continue;
+            preview = job->preview;
+            job->preview = CsvLoadResult();
         }
+        job->previewShown = true;
         
-        // 尝试转换X和Y列的数据
-        bool okX, okY;
-        double x = parts[xCol].trimmed().toDouble(&okX);
-        double y = parts[yCol].trimmed().toDouble(&okY);
+        int index = curveIndexOf(job->graph);
+        if (index >= 0) {
+            curves[index].data->set(preview.points, true);
+            shown = true;
+        }
+    }
+    
+    if (shown) {
+        // 首次显示数据时先按预览调整范围，加载完成后再按完整数据调整
+        if (!hasAutoRescaled)
+            customPlot->rescaleAxes();
+        replotScheduler->request();
+    }
+    updateLoadProgress();
+}
+
+void MainWindow::finishCurveLoad(const QSharedPointer<CurveLoadJob>& job)
+{
+    loadJobs.removeOne(job);
+    job->watcher->deleteLater();
+    updateLoadProgress();
+    
+    // 曲线已被删除或加载已被取消
+    int index = curveIndexOf(job->graph);
+    if (index < 0 || job->control.isCancelled())
+        return;
+    
+    CsvLoadResult result = job->watcher->result();
+    CurveData& curve = curves[index];
+    
+    // 新文件的列数可能更少：超出范围的列改用默认列（与原来下拉框的处理一致）
+    if (result.table) {
+        int columnCount = result.table->profile().columns.size();
+        if (curve.xColumn >= columnCount || curve.yColumn >= columnCount) {
+            if (curve.xColumn >= columnCount)
+                curve.xColumn = 0;
+            if (curve.yColumn >= columnCount)
+                curve.yColumn = columnCount > 1 ? 1 : 0;
+            bool isLogX = (customPlot->xAxis->scaleType() == QCPAxis::stLogarithmic);
+            CsvLoader::extract(result.table, curve.xColumn, curve.yColumn, isLogX, result);
+        }
+    }
+    if (job->keepData) {
+        finishCurveReload(curve, result);
+        return;
+    }
+    curve.data->set(result.points, true);
+    curve.table = result.table;
+    curve.rows = result.rows;
+    curve.hasHeader = result.hasHeader;
+    curve.headerLine = result.header;
+    if (index == currentCurveIndex)
+        updateColumnComboBoxes(curve.table, curve.xColumn, curve.yColumn);
+    
+    // 写回从修改日志中恢复的修改
+    auto recovery = pendingRecovery.find(curve.graph);
+    if (recovery != pendingRecovery.end()) {
+        if (recovery->xColumn == curve.xColumn && recovery->yColumn == curve.yColumn)
+            applyRecoveredEdits(curve, *recovery);
+        pendingRecovery.erase(recovery);
+    }
+    
+    // 如果需要则自动调整范围
+    autoRescaleIfNeeded();
+    replotScheduler->request();
+    
+    // 加载结束后再提示被过滤的点
+    showLogFilterWarning(result);
+}
+
+void MainWindow::finishCurveReload(CurveData& curve, const CsvLoadResult& result)
+{
+    if (!result.table)
+        return;  // 无法重新打开：保留现有数据，只是暂时不能拖动和保存
+    curve.table = result.table;
+    curve.hasHeader = result.hasHeader;
+    curve.headerLine = result.header;
+    if (result.rows.size() == curve.data->size()) {
+        // 行集合未变化：保留内存中的数据（包括未保存的修改），只更新行号
+        if (result.rows != curve.rows)
+            journal.discard(curve.graph);  // 日志按行号记录，旧的行号不再适用
+        curve.rows = result.rows;
+    } else {
+        if (isDragging && draggedGraph == curve.graph) {
+            // 正在拖动的点已不存在：放弃这次拖动
+            isDragging = false;
+            draggedGraph = nullptr;
+            draggedPointIndex = -1;
+            dragMarker->setVisible(false);
+            customPlot->setCursor(Qt::ArrowCursor);
+        }
+        curve.data->set(result.points, true);
+        curve.rows = result.rows;
+        history.removeGraph(curve.graph);
+        journal.discard(curve.graph);
+        updateDragControls();
+    }
+    int index = curveIndexOf(curve.graph);
+    if (index == currentCurveIndex)
+        updateColumnComboBoxes(curve.table, curve.xColumn, curve.yColumn);
+    replotScheduler->request();
+}
+
+void MainWindow::updateLoadProgress()
+{
+    if (loadJobs.isEmpty()) {
+        loadTimer->stop();
+        loadProgress->setVisible(false);
+        btnCancelLoad->setVisible(false);
+        return;
+    }
+    
+    qint64 processed = 0;
+    qint64 total = 0;
+    for (const QSharedPointer<CurveLoadJob>& job : loadJobs) {
+        processed += job->control.processed();
+        total += job->control.total();
+    }
+    
+    // 尚未开始解析（或直接复用了缓存）时显示忙碌状态
+    if (total > 0) {
+        loadProgress->setRange(0, 1000);
+        loadProgress->setValue(int(qMin<qint64>(processed * 1000 / total, 1000)));
+    } else {
+        loadProgress->setRange(0, 0);
+    }
+    loadProgress->setVisible(true);
+    btnCancelLoad->setVisible(true);
+}
+
+void MainWindow::onFollowFileToggled(bool checked)
+{
+    if (currentCurveIndex < 0 || currentCurveIndex >= curves.size())
+        return;
+    
+    curves[currentCurveIndex].followFile = checked;
+    updateFollowTimer();
+}
+
+void MainWindow::updateFollowTimer()
+{
+    for (const CurveData& curve : curves) {
+        if (curve.followFile) {
+            followTimer->start();
+            return;
+        }
+    }
+    followTimer->stop();
+}
+
+void MainWindow::onFollowTimer()
+{
+    // 每个文件只检查一次，解析新增的行后分发给使用它的曲线
+    QHash<CsvTable*, int> firstChangedRows;
+    QList<int> reloads;
+    bool changed = false;
+    for (int i = 0; i < curves.size(); ++i) {
+        CurveData& curve = curves[i];
+        if (!curve.followFile || !curve.table || !curve.table->isOpen())
+            continue;  // 未开启跟踪或仍在加载
+        if (saveJob && curve.table == saveJob->table)
+            continue;  // 正在从这个表格保存，暂不追加
         
-        // 只有当X和Y都能成功转换为数字时才添加数据点
-        if (okX && okY) {
-            // 对数坐标轴下X必须>0
-            if (isLogX && x <= 0) {
-                filteredLogPoints++;
-                skippedLines++;
+        CsvTable* table = curve.table.data();
+        if (!firstChangedRows.contains(table)) {
+            int firstChangedRow;
+            if (!table->appendFromFile(firstChangedRow)) {
+                // 文件被截断或替换：重新加载
+                firstChangedRows.insert(table, -1);
             } else {
-                xData.append(x);
-                yData.append(y);
-                rawData.append(parts);  // 保存原始数据
-                validDataLines++;
+                firstChangedRows.insert(table, firstChangedRow);
             }
-        } else {
-            skippedLines++;
         }
+        
+        int firstChangedRow = firstChangedRows.value(table);
+        if (firstChangedRow < 0) {
+            reloads.append(i);
+            continue;
+        }
+        // 加上上次因拖动而推迟合并的行
+        if (curve.pendingFollowRow >= 0)
+            firstChangedRow = qMin(firstChangedRow, curve.pendingFollowRow);
+        if (appendCurveRows(curve, firstChangedRow))
+            changed = true;
     }
     
-    file.close();
+    for (int index : reloads)
+        startCurveLoad(index);
     
-    // 如果有被过滤的对数坐标点，显示提示
-    if (filteredLogPoints > 0) {
-        QMessageBox::warning(nullptr, "对数坐标轴数据过滤", 
-            QString("对数X轴下检测到 %1 个 X≤0 的数据点。\n\n"
-                    "这些点无法在对数坐标轴上显示，已自动过滤。\n\n"
-                    "有效数据点：%2").arg(filteredLogPoints).arg(validDataLines));
+    // 多条曲线同时更新时由调度器合并为一次重绘
+    if (changed)
+        replotScheduler->request();
+}
+
+bool MainWindow::appendCurveRows(CurveData& curve, int firstRow)
+{
+    const CsvTable& table = *curve.table;
+    QMutexLocker locker(table.dataMutex());
+    if (firstRow >= table.rowCount())
+        return false;
+    
+    const QVector<double>& xs = table.numericColumn(curve.xColumn);
+    const QVector<double>& ys = table.numericColumn(curve.yColumn);
+    if (xs.size() != table.rowCount() || ys.size() != table.rowCount())
+        return false;
+    curve.pendingFollowRow = -1;
+    
+    // 末尾未写完的行被重新解析：去掉由它得到的点（数据按X排序后这些点不一定在末尾）
+    QCPGraphDataContainer& data = *curve.data;
+    auto firstRemoved = std::find_if(curve.rows.constBegin(), curve.rows.constEnd(),
+                                     [firstRow](int row) { return row >= firstRow; });
+    const int kept = int(firstRemoved - curve.rows.constBegin());
+    const bool removed = kept < curve.rows.size();
+    // 被去掉的点是否都在末尾（此时保留的点下标不变）
+    const bool tailRemoved = std::all_of(firstRemoved, curve.rows.constEnd(),
+                                         [firstRow](int row) { return row >= firstRow; });
+    
+    // 按加载时的规则筛选新增的行
+    bool isLogX = (customPlot->xAxis->scaleType() == QCPAxis::stLogarithmic);
+    QVector<QCPGraphData> added;
+    QVector<int> addedRows;
+    for (int row = firstRow; row < table.rowCount(); ++row) {
+        double x = xs[row];
+        double y = ys[row];
+        if (CsvTable::isMissing(x) || CsvTable::isMissing(y) || (isLogX && x <= 0))
+            continue;
+        added.append(QCPGraphData(x, y));
+        addedRows.append(row);
+    }
+    if (!removed && added.isEmpty())
+        return false;
+    
+    // 新数据有序且键不小于保留的最后一个点时，直接接在末尾，已有点的下标不变
+    bool sorted = std::is_sorted(added.constBegin(), added.constEnd(),
+                                 [](const QCPGraphData& a, const QCPGraphData& b) { return a.key < b.key; });
+    bool appendable = tailRemoved && sorted
+            && (kept == 0 || added.isEmpty() || added.first().key >= (data.constBegin() + (kept - 1))->key);
+    if (appendable && !removed) {
+        data.add(added, true);  // 常见情况：只是追加，不复制已有数据
+        curve.rows += addedRows;
+        return true;
+    }
+    if (isDragging && draggedGraph == curve.graph) {
+        // 重建会移动点的下标，正在拖动的点和松开时的撤销记录会对应到别的点：松开后再合并
+        curve.pendingFollowRow = firstRow;
+        return false;
     }
     
-    return !xData.isEmpty();
+    // 否则与保留的点合并后重建
+    QVector<QCPGraphData> points;
+    QVector<int> rows;
+    points.reserve(data.size() + added.size());
+    rows.reserve(data.size() + added.size());
+    QVector<PointEdit> edits;  // 保留的点中未保存的修改（文件中的值 -> 当前值）
+    int index = 0;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it, ++index) {
+        const int row = curve.rows[index];
+        if (row < firstRow) {
+            points.append(*it);
+            rows.append(row);
+            if (!sameValue(it->value, ys[row]))
+                edits.append({row, ys[row], it->value});
+        }
+    }
+    points += added;
+    rows += addedRows;
+    if (!appendable)
+        CsvLoader::sortByKey(points, rows);
+    if (removed || !appendable) {
+        // 点的下标改变或被重新解析的行替换，这条曲线旧的撤销记录不再适用
+        history.removeGraph(curve.graph);
+        updateDragControls();
+    }
+    if (removed && curve.modified) {
+        // 被重新解析的行上的修改随之丢弃，日志中只保留其余行的修改
+        journal.discard(curve.graph);
+        journal.record(EditJournal::Values, curve.graph, curve.csvFilePath, curve.xColumn, curve.yColumn, edits);
+        curve.modified = !edits.isEmpty();
+    }
+    data.set(points, true);
+    curve.rows = rows;
+    return true;
+}
+
+int MainWindow::curveIndexOf(QCPGraph* graph) const
+{
+    for (int i = 0; i < curves.size(); ++i) {
+        if (curves[i].graph == graph)
+            return i;
+    }
+    return -1;
 }
 
 void MainWindow::onPlotTitleChanged()
@@ -975,21 +1423,21 @@ void MainWindow::onPlotTitleChanged()
         customPlot->plotLayout()->addElement(0, 0, title);
     }
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onXAxisLabelChanged()
 {
     customPlot->xAxis->setLabel(edtXAxisLabel->text());
     customPlot->xAxis->setLabelFont(xAxisLabelFont);  // 设置字体
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onYAxisLabelChanged()
 {
     customPlot->yAxis->setLabel(edtYAxisLabel->text());
     customPlot->yAxis->setLabelFont(yAxisLabelFont);  // 设置字体
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onEditPlotTitle()
@@ -1279,14 +1727,14 @@ void MainWindow::onShowGridChanged(int state)
     bool show = (state == Qt::Checked);
     customPlot->xAxis->grid()->setVisible(show);
     customPlot->yAxis->grid()->setVisible(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onShowLegendChanged(int state)
 {
     bool show = (state == Qt::Checked);
     customPlot->legend->setVisible(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onShowMinorGridChanged(int state)
@@ -1294,7 +1742,7 @@ void MainWindow::onShowMinorGridChanged(int state)
     bool show = (state == Qt::Checked);
     customPlot->xAxis->grid()->setSubGridVisible(show);
     customPlot->yAxis->grid()->setSubGridVisible(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onShowX2AxisChanged(int state)
@@ -1302,7 +1750,7 @@ void MainWindow::onShowX2AxisChanged(int state)
     bool show = (state == Qt::Checked);
     customPlot->xAxis2->setVisible(show);
     customPlot->xAxis2->setTickLabels(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onShowY2AxisChanged(int state)
@@ -1310,7 +1758,7 @@ void MainWindow::onShowY2AxisChanged(int state)
     bool show = (state == Qt::Checked);
     customPlot->yAxis2->setVisible(show);
     customPlot->yAxis2->setTickLabels(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onXAxisScaleTypeChanged(int index)
@@ -1338,7 +1786,7 @@ void MainWindow::onXAxisScaleTypeChanged(int index)
         customPlot->xAxis2->setNumberFormat("eb");
         customPlot->xAxis2->setNumberPrecision(0);
     }
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onYAxisScaleTypeChanged(int index)
@@ -1366,35 +1814,35 @@ void MainWindow::onYAxisScaleTypeChanged(int index)
         customPlot->yAxis2->setNumberFormat("eb");
         customPlot->yAxis2->setNumberPrecision(0);
     }
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onXAxisTickLabelsChanged(int state)
 {
     bool show = (state == Qt::Checked);
     customPlot->xAxis->setTickLabels(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onYAxisTickLabelsChanged(int state)
 {
     bool show = (state == Qt::Checked);
     customPlot->yAxis->setTickLabels(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onX2AxisTickLabelsChanged(int state)
 {
     bool show = (state == Qt::Checked);
     customPlot->xAxis2->setTickLabels(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onY2AxisTickLabelsChanged(int state)
 {
     bool show = (state == Qt::Checked);
     customPlot->yAxis2->setTickLabels(show);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onXAxisReversedChanged(int state)
@@ -1402,7 +1850,7 @@ void MainWindow::onXAxisReversedChanged(int state)
     bool reversed = (state == Qt::Checked);
     customPlot->xAxis->setRangeReversed(reversed);
     customPlot->xAxis2->setRangeReversed(reversed);
-    customPlot->replot();
+    replotScheduler->request();
 }
 
 void MainWindow::onAxisRangeChanged()
@@ -1415,15 +1863,11 @@ void MainWindow::onAxisRangeChanged()
     customPlot->yAxis->setRange(spinYMin->value(), spinYMax->value());
     customPlot->yAxis2->setRange(spinYMin->value(), spinYMax->value());
     
-    customPlot->replot();
+    replotScheduler->request();
 }
 
-void MainWindow::updateColumnComboBoxes(const QString& filePath)
+void MainWindow::updateColumnComboBoxes(const QSharedPointer<CsvTable>& table, int xColumn, int yColumn)
 {
-    // 保存当前选择
-    int currentXIndex = cmbXColumn->currentIndex();
-    int currentYIndex = cmbYColumn->currentIndex();
-    
     // 阻塞信号，避免在更新下拉框时触发数据加载
     cmbXColumn->blockSignals(true);
     cmbYColumn->blockSignals(true);
@@ -1432,98 +1876,57 @@ void MainWindow::updateColumnComboBoxes(const QString& filePath)
     cmbXColumn->clear();
     cmbYColumn->clear();
     
-    if (filePath.isEmpty()) {
-        cmbXColumn->blockSignals(false);
-        cmbYColumn->blockSignals(false);
-        return;
-    }
-    
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        cmbXColumn->blockSignals(false);
-        cmbYColumn->blockSignals(false);
-        return;
-    }
-    
-    QTextStream in(&file);
-    if (in.atEnd()) {
-        file.close();
-        cmbXColumn->blockSignals(false);
-        cmbYColumn->blockSignals(false);
-        return;
-    }
-    
-    // 读取第一行作为表头
-    QString headerLine = in.readLine();
-    QStringList headers = headerLine.split(',');
-    
-    // 读取多行数据来检测列类型
-    QVector<QStringList> dataLines;
-    int maxCheckLines = 10; // 检查前10行来判断类型
-    while (!in.atEnd() && dataLines.size() < maxCheckLines) {
-        QString line = in.readLine();
-        if (!line.trimmed().isEmpty()) {
-            dataLines.append(line.split(','));
-        }
-    }
-    file.close();
-    
-    // 检测第一行是否为表头
-    bool hasHeader = false;
-    if (!headers.isEmpty() && !dataLines.isEmpty()) {
-        bool ok;
-        headers[0].trimmed().toDouble(&ok);
-        hasHeader = !ok; // 如果第一个值不能转为数字，说明有表头
-    }
-    
-    // 检测每列的数据类型
-    QVector<bool> isNumericColumn(headers.size(), true);
-    for (const QStringList& dataLine : dataLines) {
-        for (int i = 0; i < qMin(dataLine.size(), headers.size()); ++i) {
-            if (isNumericColumn[i]) {
-                bool ok;
-                dataLine[i].trimmed().toDouble(&ok);
-                if (!ok && !dataLine[i].trimmed().isEmpty()) {
-                    isNumericColumn[i] = false;
-                }
+    // 列概况每个文件只抽样统计一次并缓存在表格中，切换曲线时不再读取文件
+    // （表格尚未加载完成时下拉框为空，加载完成后再填充）
+    if (table && table->isOpen()) {
+        const CsvTableProfile& profile = table->profile();
+        for (int i = 0; i < profile.columns.size(); ++i) {
+            const CsvColumnProfile& column = profile.columns[i];
+            QString typeLabel;
+            switch (column.type) {
+            case CsvColumnProfile::Numeric: typeLabel = "数字"; break;
+            case CsvColumnProfile::Text: typeLabel = "文本"; break;
+            case CsvColumnProfile::Mixed: typeLabel = "混合"; break;  // 数字中夹杂文本
+            default: typeLabel = "空"; break;
             }
+            if (column.order == CsvColumnProfile::Increasing)
+                typeLabel += "，递增";
+            else if (column.order == CsvColumnProfile::Decreasing)
+                typeLabel += "，递减";
+            
+            QString columnName;
+            if (profile.hasHeader && !column.name.isEmpty()) {
+                // 有表头：显示 "Column A: 列名 (类型)"
+                columnName = QString("Column %1: %2 (%3)")
+                    .arg(QChar('A' + i))
+                    .arg(column.name)
+                    .arg(typeLabel);
+            } else {
+                // 无表头：显示 "Column A (类型)"
+                columnName = QString("Column %1 (%2)")
+                    .arg(QChar('A' + i))
+                    .arg(typeLabel);
+            }
+            
+            // 悬停提示显示抽样统计
+            QString toolTip = QString("空值：%1%\n非数字：%2%")
+                .arg(column.emptyRatio * 100, 0, 'f', 1)
+                .arg(column.nanRatio * 100, 0, 'f', 1);
+            if (column.type == CsvColumnProfile::Numeric || column.type == CsvColumnProfile::Mixed)
+                toolTip += QString("\n范围：%1 ~ %2").arg(column.minimum).arg(column.maximum);
+            
+            cmbXColumn->addItem(columnName, i);
+            cmbYColumn->addItem(columnName, i);
+            cmbXColumn->setItemData(i, toolTip, Qt::ToolTipRole);
+            cmbYColumn->setItemData(i, toolTip, Qt::ToolTipRole);
         }
     }
     
-    // 填充下拉框
-    for (int i = 0; i < headers.size(); ++i) {
-        QString columnName;
-        QString typeLabel = isNumericColumn[i] ? "数字" : "文本";
-        
-        if (hasHeader) {
-            // 有表头：显示 "Column A: 列名 (类型)"
-            columnName = QString("Column %1: %2 (%3)")
-                .arg(QChar('A' + i))
-                .arg(headers[i].trimmed())
-                .arg(typeLabel);
-        } else {
-            // 无表头：显示 "Column A (类型)"
-            columnName = QString("Column %1 (%2)")
-                .arg(QChar('A' + i))
-                .arg(typeLabel);
-        }
-        
-        cmbXColumn->addItem(columnName, i);
-        cmbYColumn->addItem(columnName, i);
-    }
-    
-    // 恢复之前的选择，如果索引有效
-    if (currentXIndex >= 0 && currentXIndex < cmbXColumn->count())
-        cmbXColumn->setCurrentIndex(currentXIndex);
-    else if (cmbXColumn->count() > 0)
-        cmbXColumn->setCurrentIndex(0);
-        
-    if (currentYIndex >= 0 && currentYIndex < cmbYColumn->count())
-        cmbYColumn->setCurrentIndex(currentYIndex);
-    else if (cmbYColumn->count() > 1)
-        cmbYColumn->setCurrentIndex(1);
-    else if (cmbYColumn->count() > 0)
-        cmbYColumn->setCurrentIndex(0);
+    // 选中曲线当前使用的列
+    if (xColumn >= 0 && xColumn < cmbXColumn->count())
+        cmbXColumn->setCurrentIndex(xColumn);
+    if (yColumn >= 0 && yColumn < cmbYColumn->count())
+        cmbYColumn->setCurrentIndex(yColumn);
     
     // 恢复信号
     cmbXColumn->blockSignals(false);
@@ -1546,6 +1949,7 @@ void MainWindow::onDragModeToggled(bool enabled)
         
         // 启用相关按钮
         updateDragControls();
+        updateDragLayer();
     } else {
         // 禁用拉点模式
         lblDragStatus->setText("状态：未启用");
@@ -1558,9 +1962,11 @@ void MainWindow::onDragModeToggled(bool enabled)
         isDragging = false;
         draggedGraph = nullptr;
         draggedPointIndex = -1;
+        dragMarker->setVisible(false);
         
         // 禁用按钮
         updateDragControls();
+        updateDragLayer();
     }
 }
 
@@ -1582,93 +1988,277 @@ void MainWindow::onSaveModifiedData()
     if (fileName.isEmpty())
         return;
     
-    // 保存数据到CSV
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, "错误", "无法打开文件进行写入");
+    if (!curve.table || !curve.table->isOpen()) {
+        QMessageBox::critical(this, "错误", "原始CSV数据不可用");
+        return;
+    }
+    if (saveJob) {
+        QMessageBox::information(this, "提示", "正在保存其他数据，请稍候");
         return;
     }
     
-    QTextStream out(&file);
-    
-    // 写入表头（如果有）
-    if (curve.hasHeader && !curve.headerLine.isEmpty()) {
-        out << curve.headerLine.join(",") << "\n";
+    // 保存数据到CSV（先写临时文件，提交时替换目标文件）
+    QSharedPointer<CurveSaveJob> job(new CurveSaveJob);
+    job->file.setFileName(fileName);
+    if (!job->file.open(QIODevice::WriteOnly)) {
+        QMessageBox::critical(this, "错误", "无法打开文件进行写入");
+        return;
     }
     
-    // 写入数据（使用原始数据，但更新Y列）
-    for (int i = 0; i < curve.rawDataLines.size() && i < curve.yData.size(); ++i) {
-        QStringList line = curve.rawDataLines[i];
-        
-        // 更新Y列的值
-        if (curve.yColumn < line.size()) {
-            line[curve.yColumn] = QString::number(curve.yData[i], 'g', 10);
+    // 在工作线程中从数据快照写出文件：复制容器只增加引用计数，保存期间可以继续拖动和平移
+    job->graph = curve.graph;
+    job->fileName = fileName;
+    job->table = curve.table;
+    job->snapshot = *curve.data;
+    job->rows = curve.rows;
+    job->revision = curve.data->revision();
+    {
+        // 只改写与文件中的值不同的Y单元格：在这里比较并找出单元格位置（只扫描被修改的行），
+        // 工作线程写出时不再持有表格的锁，不会阻塞界面线程读取表格
+        const CsvTable& table = *curve.table;
+        QMutexLocker locker(table.dataMutex());
+        const QVector<double>& fileValues = table.numericColumn(curve.yColumn);
+        QVector<int> rows;
+        QVector<double> values;
+        int i = 0;
+        for (auto it = job->snapshot.constBegin(); it != job->snapshot.constEnd(); ++it, ++i) {
+            int row = job->rows[i];
+            if (row < fileValues.size() && !sameValue(it->value, fileValues[row])) {
+                rows.append(row);
+                values.append(it->value);
+            }
         }
-        
-        out << line.join(",") << "\n";
+        job->patches = CsvWriter::locateCells(table, curve.yColumn, rows, values);
+        job->sourcePath = table.filePath();
+        job->sourceSize = table.source().size();
     }
+    job->watcher = new QFutureWatcher<bool>(this);
+    connect(job->watcher, &QFutureWatcherBase::finished, this, [this, job]() { finishSave(job); });
+    job->watcher->setFuture(QtConcurrent::run([job]() {
+        // 源文件原样复制；文件被截断或替换时单元格位置不再可靠，放弃保存
+        CsvFile source;
+        if (!source.open(job->sourcePath) || source.size() < job->sourceSize)
+            return false;
+        return CsvWriter::writePatched(job->file, source, job->patches, &job->control);
+    }));
+    
+    saveJob = job;
+    updateSaveProgress();
+    saveTimer->start();
+    updateDragControls();
+}
+
+void MainWindow::finishSave(const QSharedPointer<CurveSaveJob>& job)
+{
+    saveJob.clear();
+    job->watcher->deleteLater();
+    updateSaveProgress();
+    updateDragControls();
     
-    file.close();
+    if (!job->watcher->result()) {
+        job->file.cancelWriting();
+        QMessageBox::critical(this, "错误", "写入文件失败");
+        return;
+    }
+    
+    // 覆盖原文件时需要先释放对它的映射，提交后再重新映射
+    QList<int> remapped = releaseCsvSources(job->fileName);
+    bool committed = job->file.commit();
+    reloadCsvSources(remapped);
     
-    curve.modified = false;
+    if (!committed) {
+        QMessageBox::critical(this, "错误", "写入文件失败");
+        return;
+    }
+    
+    markCurveSaved(*job);
     updateDragControls();
     
-    QMessageBox::information(this, "成功", QString("数据已保存到：\n%1").arg(fileName));
+    statusBar()->showMessage(QString("数据已保存到：%1").arg(job->fileName), 5000);
 }
 
-void MainWindow::onUndo()
+void MainWindow::markCurveSaved(const CurveSaveJob& job)
 {
-    if (undoStack.isEmpty())
+    int index = curveIndexOf(job.graph);
+    if (index < 0)
         return;
     
-    HistoryState currentState;
-    currentState.curveIndex = currentCurveIndex;
-    if (currentCurveIndex >= 0 && currentCurveIndex < curves.size()) {
-        currentState.yData = curves[currentCurveIndex].yData;
+    CurveData& curve = curves[index];
+    journal.markSaved(curve.graph);
+    if (curve.data->revision() == job.revision) {
+        curve.modified = false;
+    } else if (curve.data->size() == job.snapshot.size() && curve.rows == job.rows) {
+        // 保存期间又有修改：快照之后改变的点仍为未保存，重新记入日志（文件中的值为快照中的值）
+        QVector<PointEdit> edits;
+        auto saved = job.snapshot.constBegin();
+        int i = 0;
+        for (auto it = curve.data->constBegin(); it != curve.data->constEnd(); ++it, ++saved, ++i) {
+            if (!sameValue(it->value, saved->value))
+                edits.append({curve.rows[i], saved->value, it->value});
+        }
+        journal.record(EditJournal::Values, curve.graph, curve.csvFilePath, curve.xColumn, curve.yColumn, edits);
+        curve.modified = !edits.isEmpty();
+    }
+}
+
+void MainWindow::updateSaveProgress()
+{
+    if (!saveJob) {
+        saveTimer->stop();
+        saveProgress->setVisible(false);
+        return;
     }
     
-    HistoryState prevState = undoStack.pop();
-    
-    // 保存当前状态到重做栈
-    redoStack.push(currentState);
-    
-    // 恢复到之前的状态
-    if (prevState.curveIndex >= 0 && prevState.curveIndex < curves.size()) {
-        curves[prevState.curveIndex].yData = prevState.yData;
-        curves[prevState.curveIndex].graph->setData(curves[prevState.curveIndex].xData, 
-                                                     curves[prevState.curveIndex].yData);
-        curves[prevState.curveIndex].modified = true;
-        customPlot->replot();
+    qint64 total = saveJob->control.total();
+    if (total > 0) {
+        saveProgress->setRange(0, 1000);
+        saveProgress->setValue(int(qMin<qint64>(saveJob->control.processed() * 1000 / total, 1000)));
+    } else {
+        saveProgress->setRange(0, 0);
     }
+    saveProgress->setVisible(true);
+}
+
+QList<int> MainWindow::releaseCsvSources(const QString& filePath)
+{
+    QList<int> released;
+    QString target = QFileInfo(filePath).absoluteFilePath();
+    for (int i = 0; i < curves.size(); ++i) {
+        const QSharedPointer<CsvTable>& table = curves[i].table;
+        if (table && table->isOpen() && QFileInfo(table->filePath()).absoluteFilePath() == target) {
+            table->release();
+            released.append(i);
+        }
+    }
+    return released;
+}
+
+void MainWindow::reloadCsvSources(const QList<int>& curveIndexes)
+{
+    // 文件已改变，在后台重新解析得到新的共享表格；完成前曲线保留内存中的数据（包括未保存的修改）
+    for (int index : curveIndexes)
+        startCurveLoad(index, true);
+}
+
+void MainWindow::onUndo()
+{
+    if (!history.canUndo())
+        return;
     
+    applyEdits(history.undo(), true);
     updateDragControls();
 }
 
 void MainWindow::onRedo()
 {
-    if (redoStack.isEmpty())
+    if (!history.canRedo())
         return;
     
-    HistoryState currentState;
-    currentState.curveIndex = currentCurveIndex;
-    if (currentCurveIndex >= 0 && currentCurveIndex < curves.size()) {
-        currentState.yData = curves[currentCurveIndex].yData;
-    }
+    applyEdits(history.redo(), false);
+    updateDragControls();
+}
+
+void MainWindow::applyEdits(const EditCommand& command, bool undo)
+{
+    int index = curveIndexOf(command.graph);
+    if (index < 0)
+        return;
     
-    HistoryState nextState = redoStack.pop();
+    // 只改写记录中的点，与曲线点数无关
+    CurveData& curve = curves[index];
+    for (const PointEdit& edit : command.edits) {
+        if (edit.index >= curve.data->size())
+            continue;
+        QCPGraphData point = *curve.data->at(edit.index);
+        point.value = undo ? edit.oldValue : edit.newValue;
+        curve.data->update(edit.index, point);
+        curve.pointIndex->pointChanged(*curve.data, edit.index);
+    }
+    curve.modified = true;
+    journalEdits(undo ? EditJournal::Undo : EditJournal::Redo, curve, command);
+    replotScheduler->request();
+}
+
+void MainWindow::journalEdits(EditJournal::Operation operation, const CurveData& curve, const EditCommand& command)
+{
+    // 日志中以表格行号标识数据点，重新排序后仍然有效
+    QVector<PointEdit> edits;
+    edits.reserve(command.edits.size());
+    for (const PointEdit& edit : command.edits) {
+        if (edit.index < curve.rows.size())
+            edits.append({curve.rows[edit.index], edit.oldValue, edit.newValue});
+    }
+    journal.record(operation, curve.graph, curve.csvFilePath, curve.xColumn, curve.yColumn, edits);
+}
+
+void MainWindow::recoverEdits()
+{
+    QVector<RecoveredCurve> recovered = journal.recover();
+    if (recovered.isEmpty()) {
+        journal.discardRecovered();
+        return;
+    }
     
-    // 保存当前状态到撤销栈
-    undoStack.push(currentState);
+    QStringList names;
+    for (const RecoveredCurve& curve : recovered)
+        names << QString("%1（%2 个点）").arg(QFileInfo(curve.filePath).fileName()).arg(curve.values.size());
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "恢复修改",
+        QString("上次运行时有 %1 条曲线的修改没有保存：\n%2\n\n是否恢复这些修改？")
+            .arg(recovered.size()).arg(names.join("\n")),
+        QMessageBox::Yes | QMessageBox::No);
     
-    // 恢复到之后的状态
-    if (nextState.curveIndex >= 0 && nextState.curveIndex < curves.size()) {
-        curves[nextState.curveIndex].yData = nextState.yData;
-        curves[nextState.curveIndex].graph->setData(curves[nextState.curveIndex].xData, 
-                                                     curves[nextState.curveIndex].yData);
-        curves[nextState.curveIndex].modified = true;
-        customPlot->replot();
+    if (reply == QMessageBox::Yes) {
+        for (const RecoveredCurve& curve : recovered) {
+            if (!QFileInfo::exists(curve.filePath))
+                continue;
+            int index = addCurve(curve.filePath, curve.xColumn, curve.yColumn);
+            QCPGraph* graph = curves[index].graph;
+            // 先写入本次会话的日志，再删除旧日志，恢复过程中崩溃也不会丢失
+            for (const QVector<PointEdit>& edits : curve.history)
+                journal.record(EditJournal::History, graph, curve.filePath, curve.xColumn, curve.yColumn, edits);
+            journal.record(EditJournal::Values, graph, curve.filePath, curve.xColumn, curve.yColumn, curve.values);
+            pendingRecovery.insert(graph, curve);
+        }
+        if (!curves.isEmpty())
+            curveList->setCurrentRow(curves.size() - 1);
+        replotScheduler->request();
     }
+    journal.discardRecovered();
+}
+
+void MainWindow::applyRecoveredEdits(CurveData& curve, const RecoveredCurve& recovered)
+{
+    if (curve.rows.isEmpty())
+        return;
+    
+    // 表格行号 -> 数据点下标
+    QVector<int> indexOfRow(*std::max_element(curve.rows.constBegin(), curve.rows.constEnd()) + 1, -1);
+    for (int i = 0; i < curve.rows.size(); ++i)
+        indexOfRow[curve.rows[i]] = i;
+    auto toIndexes = [&indexOfRow](const QVector<PointEdit>& edits) {
+        QVector<PointEdit> result;
+        result.reserve(edits.size());
+        for (const PointEdit& edit : edits) {
+            if (edit.index >= 0 && edit.index < indexOfRow.size() && indexOfRow[edit.index] >= 0)
+                result.append({indexOfRow[edit.index], edit.oldValue, edit.newValue});
+        }
+        return result;
+    };
     
+    for (const PointEdit& edit : toIndexes(recovered.values)) {
+        QCPGraphData point = *curve.data->at(edit.index);
+        point.value = edit.newValue;
+        curve.data->update(edit.index, point);
+    }
+    // 恢复的撤销记录接在已有记录之后（空间索引在下次查询时重建）
+    for (const QVector<PointEdit>& edits : recovered.history) {
+        EditCommand command;
+        command.graph = curve.graph;
+        command.edits = toIndexes(edits);
+        if (!command.edits.isEmpty())
+            history.push(command);
+    }
+    curve.modified = true;
     updateDragControls();
 }
 
@@ -1690,26 +2280,26 @@ void MainWindow::onResetData()
     
     if (reply == QMessageBox::Yes) {
         // 重新加载原始数据
-        QVector<double> newXData, newYData;
-        QVector<QStringList> newRawData;
+        QCPGraphDataContainer newData;
+        QSharedPointer<CsvTable> newTable;
+        QVector<int> newRows;
         bool newHasHeader;
         QStringList newHeader;
-        if (loadCSV(curve.csvFilePath, curve.xColumn, curve.yColumn, newXData, newYData,
-                    newRawData, newHasHeader, newHeader)) {
-            curve.xData = newXData;
-            curve.yData = newYData;
-            curve.rawDataLines = newRawData;
+        if (loadCSV(curve.csvFilePath, curve.xColumn, curve.yColumn, newData,
+                    newTable, newRows, newHasHeader, newHeader)) {
+            curve.data->set(newData);
+            curve.table = newTable;
+            curve.rows = newRows;
             curve.hasHeader = newHasHeader;
             curve.headerLine = newHeader;
-            curve.graph->setData(curve.xData, curve.yData);
             curve.modified = false;
             
-            // 清空撤销/重做栈
-            undoStack.clear();
-            redoStack.clear();
+            // 清除这条曲线的撤销/重做记录
+            history.removeGraph(curve.graph);
+            journal.discard(curve.graph);
             
             updateDragControls();
-            customPlot->replot();
+            replotScheduler->request();
             
             QMessageBox::information(this, "成功", "数据已重置为原始状态");
         } else {
@@ -1725,51 +2315,25 @@ void MainWindow::onPlotMousePress(QMouseEvent* event)
     
     if (event->button() == Qt::LeftButton) {
         CurveData& curve = curves[currentCurveIndex];
+        if (!curve.table)
+            return;  // 仍在加载，显示的只是预览数据
         
-        // 使用selectTest检测是否点击到了数据点
-        double distance = curve.graph->selectTest(event->pos(), false);
-        
-        // distance < 0 表示未选中，>= 0 表示选中（值越小越接近）
-        if (distance >= 0 && distance < 20) {
-            // 手动查找最近的数据点
-            double x = customPlot->xAxis->pixelToCoord(event->pos().x());
-            double y = customPlot->yAxis->pixelToCoord(event->pos().y());
+        // 用空间索引查找像素距离最近的可见数据点，数据未变化时不重建索引
+        int nearestIdx = curve.pointIndex->nearest(*curve.data, curve.graph->keyAxis(), curve.graph->valueAxis(),
+                                                   event->pos(), kDragGrabRadius, nullptr,
+                                                   curve.graph->keyAxis()->axisRect()->rect());
+        if (nearestIdx >= 0) {
+            isDragging = true;
+            draggedGraph = curve.graph;
+            draggedPointIndex = nearestIdx;
+            dragStartValue = curve.data->at(nearestIdx)->value;  // 松开时与最终值一起记入撤销记录
             
-            // 在数据中查找最近的点
-            double minDist = 1e10;
-            int nearestIdx = -1;
-            
-            for (int i = 0; i < curve.xData.size(); ++i) {
-                double dataX = curve.xData[i];
-                double dataY = curve.yData[i];
-                
-                // 转换为像素坐标计算距离
-                double pixelX = customPlot->xAxis->coordToPixel(dataX);
-                double pixelY = customPlot->yAxis->coordToPixel(dataY);
-                double mousePosX = customPlot->xAxis->coordToPixel(x);
-                double mousePosY = customPlot->yAxis->coordToPixel(y);
-                
-                double dx = pixelX - mousePosX;
-                double dy = pixelY - mousePosY;
-                double dist = qSqrt(dx * dx + dy * dy);
-                
-                if (dist < minDist) {
-                    minDist = dist;
-                    nearestIdx = i;
-                }
-            }
-            
-            if (nearestIdx >= 0 && minDist < 30) {  // 30像素容差
-                isDragging = true;
-                draggedGraph = curve.graph;
-                draggedPointIndex = nearestIdx;
-                
-                // 保存当前状态到撤销栈
-                saveHistoryState();
-                
-                // 高亮显示选中的点
-                customPlot->setCursor(Qt::ClosedHandCursor);
-            }
+            // 高亮显示选中的点
+            customPlot->setCursor(Qt::ClosedHandCursor);
+            const QCPGraphData& point = *curve.data->at(nearestIdx);
+            dragMarker->setData(QVector<double>() << point.key, QVector<double>() << point.value, true);
+            dragMarker->setVisible(true);
+            replotScheduler->request(dragLayer);
         }
     }
 }
@@ -1789,20 +2353,31 @@ void MainWindow::onPlotMouseMove(QMouseEvent* event)
         double newY = customPlot->yAxis->pixelToCoord(event->pos().y());
         
         // 更新数据点的Y值（X值保持不变）
-        if (draggedPointIndex < curve.yData.size()) {
-            curve.yData[draggedPointIndex] = newY;
-            curve.graph->setData(curve.xData, curve.yData);
+        if (draggedPointIndex < curve.data->size()) {
+            // 只更新共享容器中的这一个点（X不变，排序不受影响），缓存的数值范围随之调整，与曲线点数无关
+            QCPGraphData point = *curve.data->at(draggedPointIndex);
+            point.value = newY;
+            curve.data->update(draggedPointIndex, point);
+            curve.pointIndex->pointChanged(*curve.data, draggedPointIndex);
             curve.modified = true;
+            dragMarker->data()->update(0, point);
             
-            customPlot->replot();
+            // 曲线和标记都在拖动层上，只重绘这一层
+            replotScheduler->request(dragLayer);
             updateDragControls();
         }
     } else if (dragModeEnabled && currentCurveIndex >= 0 && currentCurveIndex < curves.size()) {
-        // 鼠标悬停时检查是否在数据点附近
+        // 鼠标悬停时检查是否在数据点附近：与按下时相同，用空间索引只查找鼠标附近可见的点，
+        // 不经过 selectTest（它会为整条曲线生成折线，即使线条不可见）；同一像素上的重复查询直接取缓存
         CurveData& curve = curves[currentCurveIndex];
-        double distance = curve.graph->selectTest(event->pos(), false);
+        int index = -1;
+        if (curve.table) {
+            index = curve.pointIndex->nearest(*curve.data, curve.graph->keyAxis(), curve.graph->valueAxis(),
+                                              event->pos(), kDragGrabRadius, nullptr,
+                                              curve.graph->keyAxis()->axisRect()->rect());
+        }
         
-        if (distance >= 0 && distance < 20) {
+        if (index >= 0) {
             customPlot->setCursor(Qt::OpenHandCursor);
         } else {
             customPlot->setCursor(Qt::ArrowCursor);
@@ -1813,40 +2388,43 @@ void MainWindow::onPlotMouseMove(QMouseEvent* event)
 void MainWindow::onPlotMouseRelease(QMouseEvent* event)
 {
     if (isDragging) {
+        // 一次拖动记为一条撤销记录，只保存这个点的下标和前后的值（同时丢弃可重做的记录）
+        int index = curveIndexOf(draggedGraph);
+        if (index >= 0 && draggedPointIndex < curves[index].data->size()) {
+            double newValue = curves[index].data->at(draggedPointIndex)->value;
+            if (newValue != dragStartValue) {
+                EditCommand command;
+                command.graph = draggedGraph;
+                command.edits.append({draggedPointIndex, dragStartValue, newValue});
+                history.push(command);
+                journalEdits(EditJournal::Command, curves[index], command);
+            }
+        }
+        
         isDragging = false;
         draggedGraph = nullptr;
         draggedPointIndex = -1;
         customPlot->setCursor(Qt::ArrowCursor);
-        
-        // 清空重做栈（因为进行了新操作）
-        redoStack.clear();
+        dragMarker->setVisible(false);
+        replotScheduler->request(dragLayer);
         updateDragControls();
     }
 }
 
-void MainWindow::saveHistoryState()
+void MainWindow::updateDragLayer()
 {
-    if (currentCurveIndex < 0 || currentCurveIndex >= curves.size())
-        return;
-    
-    HistoryState state;
-    state.curveIndex = currentCurveIndex;
-    state.yData = curves[currentCurveIndex].yData;
-    
-    undoStack.push(state);
-    
-    // 限制撤销栈大小（最多50步）
-    if (undoStack.size() > 50) {
-        // 移除最早的记录
-        QStack<HistoryState> temp;
-        while (undoStack.size() > 1) {
-            temp.push(undoStack.pop());
-        }
-        undoStack.clear();
-        while (!temp.isEmpty()) {
-            undoStack.push(temp.pop());
+    // 层的内容改变后需要完整重绘一次，之后拖动时才能只重绘拖动层
+    QCPLayer* mainLayer = customPlot->layer("main");
+    bool changed = false;
+    for (int i = 0; i < curves.size(); ++i) {
+        QCPLayer* layer = (dragModeEnabled && i == currentCurveIndex) ? dragLayer : mainLayer;
+        if (curves[i].graph->layer() != layer) {
+            curves[i].graph->setLayer(layer);
+            changed = true;
         }
     }
+    if (changed)
+        replotScheduler->request();
 }
 
 void MainWindow::updateDragControls()
@@ -1856,18 +2434,18 @@ void MainWindow::updateDragControls()
         hasModified = curves[currentCurveIndex].modified;
     }
     
-    bool hasUndo = !undoStack.isEmpty();
-    bool hasRedo = !redoStack.isEmpty();
+    bool hasUndo = history.canUndo();
+    bool hasRedo = history.canRedo();
     
     btnUndo->setEnabled(dragModeEnabled && hasUndo);
     btnRedo->setEnabled(dragModeEnabled && hasRedo);
-    btnSaveData->setEnabled(dragModeEnabled && hasModified);
+    btnSaveData->setEnabled(dragModeEnabled && hasModified && !saveJob);
     btnResetData->setEnabled(dragModeEnabled && hasModified);
     
     // 更新状态标签
     if (hasModified) {
         lblDragStatus->setText(QString("状态：<b style='color: #4CAF50;'>已启用</b> | <span style='color: #ff9800;'>已修改 (%1步可撤销)</span>")
-                              .arg(undoStack.size()));
+                              .arg(history.undoCount()));
     } else if (dragModeEnabled) {
         lblDragStatus->setText("状态：<b style='color: #4CAF50;'>已启用</b>");
     }
@@ -1875,41 +2453,16 @@ void MainWindow::updateDragControls()
 
 int MainWindow::findNearestPoint(QCPGraph* graph, const QPointF& pos, double& distance)
 {
-    if (!graph || graph->data()->isEmpty()) {
-        distance = 1e10;
+    // pos 为数据坐标，距离以像素计
+    distance = 1e10;
+    int index = curveIndexOf(graph);
+    if (index < 0 || graph->data()->isEmpty())
         return -1;
-    }
-    
-    int nearestIndex = -1;
-    double minDistPixels = 1e10;
-    
-    QCPGraphDataContainer::const_iterator begin = graph->data()->constBegin();
-    QCPGraphDataContainer::const_iterator end = graph->data()->constEnd();
-    
-    int index = 0;
-    for (QCPGraphDataContainer::const_iterator it = begin; it != end; ++it, ++index) {
-        // 获取数据点坐标
-        double dataX = it->key;
-        double dataY = it->value;
-        
-        // 转换为像素坐标计算距离
-        double pixelX = customPlot->xAxis->coordToPixel(dataX);
-        double pixelY = customPlot->yAxis->coordToPixel(dataY);
-        double mousePosX = customPlot->xAxis->coordToPixel(pos.x());
-        double mousePosY = customPlot->yAxis->coordToPixel(pos.y());
-        
-        double dx = pixelX - mousePosX;
-        double dy = pixelY - mousePosY;
-        double dist = qSqrt(dx * dx + dy * dy);
-        
-        if (dist < minDistPixels) {
-            minDistPixels = dist;
-            nearestIndex = index;
-        }
-    }
     
-    distance = minDistPixels;
-    return nearestIndex;
+    const CurveData& curve = curves[index];
+    QPointF pixel = graph->coordsToPixels(pos.x(), pos.y());
+    return curve.pointIndex->nearest(*curve.data, graph->keyAxis(), graph->valueAxis(), pixel,
+                                     std::numeric_limits<double>::infinity(), &distance);
 }
 
 // ========== 导出图片功能 ==========
@@ -13,14 +13,28 @@
 #include <QColorDialog>
 #include <QCheckBox>
 #include <QScrollArea>
-#include <QStack>
+#include <QSharedPointer>
+#include <QProgressBar>
+#include <QTimer>
+#include <QMutex>
+#include <QFutureWatcher>
+#include <QSaveFile>
 #include "qcustomplot.h"
+#include "csvfile.h"
+#include "csvloader.h"
+#include "csvtable.h"
+#include "csvwriter.h"
+#include "edithistory.h"
+#include "editjournal.h"
+#include "pointindex.h"
+#include "replotscheduler.h"
 
 struct CurveData {
     QString name;
     QString csvFilePath;
-    QVector<double> xData;
-    QVector<double> yData;
+    // 曲线数据的唯一副本（按X排序），与 graph 共享，编辑时原地修改
+    QSharedPointer<QCPGraphDataContainer> data;
+    QSharedPointer<PointIndex> pointIndex;  // data 的空间索引（拉点时查找最近点）
     QCPGraph* graph;
     QColor color;
     Qt::PenStyle lineStyle;
@@ -31,16 +45,45 @@ struct CurveData {
     double scatterSize;
     bool modified;  // 新增：标记是否被修改过
     
-    // 保存原始CSV的完整数据
-    QVector<QStringList> rawDataLines;  // 每行的原始数据（所有列）
+    // 原始CSV数据：同一文件的曲线共享一份列式表格，只记录每个数据点所在的行号
+    QSharedPointer<CsvTable> table;
+    QVector<int> rows;  // 每个数据点对应的表格行号（与 data 中的点一一对应）
     bool hasHeader;  // 是否有表头
     QStringList headerLine;  // 表头行
+    bool followFile;  // 跟踪文件末尾，自动追加新写入的行
+    int pendingFollowRow;  // 拖动这条曲线期间推迟合并的第一个新增行，-1 表示没有
 };
 
-// 用于撤销/重做的历史记录结构
-struct HistoryState {
-    int curveIndex;  // 哪条曲线
-    QVector<double> yData;  // Y数据快照
+// 后台加载任务（界面线程与工作线程共享）
+struct CurveLoadJob {
+    QCPGraph* graph = nullptr;  // 目标曲线，只用于比较（曲线可能在加载期间被删除）
+    QString filePath;
+    int xColumn = 0;
+    int yColumn = 0;
+    QSharedPointer<CsvTable> table;  // 曲线原来使用的同一文件的表格，加载期间保持打开，文件未变化时只补充解析新的列
+    bool keepData = false;  // 重新打开被覆盖保存的源文件：加载期间保留曲线的数据，完成后只更新行号
+    QFutureWatcher<CsvLoadResult>* watcher = nullptr;
+    CsvLoadControl control;  // 进度与取消
+    QMutex previewMutex;
+    CsvLoadResult preview;  // 文件开头的若干行，完整加载结束前先显示
+    bool previewReady = false;
+    bool previewShown = false;
+};
+
+// 后台保存任务
+struct CurveSaveJob {
+    QCPGraph* graph = nullptr;  // 被保存的曲线，只用于比较（曲线可能在保存期间被删除）
+    QString fileName;
+    QSharedPointer<CsvTable> table;
+    QCPGraphDataContainer snapshot;  // 开始保存时的数据，与曲线隐式共享，保存期间的修改会先复制一份
+    QVector<int> rows;
+    QString sourcePath;  // 源文件，工作线程另行映射，不持有表格的锁
+    qint64 sourceSize = 0;  // 开始保存时表格对应的文件大小
+    QVector<CsvPatch> patches;  // 要改写的Y单元格，按文件位置排列
+    quint64 revision = 0;  // 快照时曲线数据的修订号
+    QSaveFile file;  // 写入临时文件，提交时替换目标文件
+    QFutureWatcher<bool>* watcher = nullptr;
+    CsvLoadControl control;  // 进度
 };
 
 class MainWindow : public QMainWindow
@@ -98,30 +141,71 @@ private slots:
     void onPlotMousePress(QMouseEvent* event);
     void onPlotMouseMove(QMouseEvent* event);
     void onPlotMouseRelease(QMouseEvent* event);
+    
+    // 后台加载槽函数
+    void onCancelLoad();
+    void onLoadTimer();  // 定时刷新进度并显示预览数据
+    
+    // 跟踪文件槽函数
+    void onFollowFileToggled(bool checked);
+    void onFollowTimer();  // 检查跟踪的文件并追加新行
 
 private:
     void setupUI();
+    int addCurve(const QString& filePath, int xColumn, int yColumn);  // 新建曲线并开始加载，返回曲线下标
     QWidget* setupLeftPanel();
     void setupCenterPanel();
     void setupRightPanel();
     void updateCurveProperties();
     void updatePlotProperties();
-    bool loadCSV(const QString& filePath, int xCol, int yCol, QVector<double>& xData, QVector<double>& yData,
-                 QVector<QStringList>& rawData, bool& hasHeader, QStringList& header);
-    void updateColumnComboBoxes(const QString& filePath);
+    bool loadCSV(const QString& filePath, int xCol, int yCol, QCPGraphDataContainer& data,
+                 QSharedPointer<CsvTable>& table, QVector<int>& rows, bool& hasHeader, QStringList& header,
+                 bool showWarning = true);
+    void updateColumnComboBoxes(const QSharedPointer<CsvTable>& table, int xColumn, int yColumn);
     void autoRescaleIfNeeded();  // 新增：如果需要则自动调整范围
     bool hasAnyValidData();  // 新增：检查是否有任何有效数据
+    QList<int> releaseCsvSources(const QString& filePath);  // 释放对指定文件的映射，返回受影响的曲线
+    void reloadCsvSources(const QList<int>& curveIndexes);  // 在后台重新打开源文件，完成后刷新行号
+    void showLogFilterWarning(const CsvLoadResult& result);  // 提示对数坐标下被过滤的点
+    
+    // 后台加载辅助函数
+    // 在工作线程中加载曲线数据（取代该曲线未完成的加载）；keepData 为 true 时加载期间保留曲线现有的数据
+    void startCurveLoad(int curveIndex, bool keepData = false);
+    void reloadCurveColumns(int curveIndex);  // 切换X/Y列后重新取出曲线数据
+    void cancelCurveLoad(QCPGraph* graph);
+    void finishCurveLoad(const QSharedPointer<CurveLoadJob>& job);
+    void finishCurveReload(CurveData& curve, const CsvLoadResult& result);  // 保留数据的重新加载完成
+    void updateLoadProgress();
+    int curveIndexOf(QCPGraph* graph) const;
+    
+    // 后台保存辅助函数
+    void finishSave(const QSharedPointer<CurveSaveJob>& job);
+    void markCurveSaved(const CurveSaveJob& job);  // 提交后把快照中的修改标记为已保存
+    void updateSaveProgress();
+    
+    // 跟踪文件辅助函数
+    void updateFollowTimer();  // 有曲线开启跟踪时才运行定时器
+    bool appendCurveRows(CurveData& curve, int firstRow);  // 把表格中 firstRow 起的行追加到曲线，返回是否有变化
     
     // 拉点功能辅助函数
-    void saveHistoryState();  // 保存当前状态到历史记录
+    void updateDragLayer();  // 拉点模式下把当前曲线移到拖动层，否则移回主图层
+    void applyEdits(const EditCommand& command, bool undo);  // 撤销时写回旧值，重做时写回新值
+    void journalEdits(EditJournal::Operation operation, const CurveData& curve, const EditCommand& command);  // 按行号写入修改日志
+    void recoverEdits();  // 启动时询问是否恢复上次未保存的修改
+    void applyRecoveredEdits(CurveData& curve, const RecoveredCurve& recovered);  // 曲线加载完成后写回恢复的修改
     void updateDragControls();  // 更新拉点控件状态
     int findNearestPoint(QCPGraph* graph, const QPointF& pos, double& distance);  // 查找最近的点
     
     // UI组件
     QCustomPlot* customPlot;
+    ReplotScheduler* replotScheduler;  // 合并重绘请求
+    QLabel* lblFrameRate;
+    QProgressBar* saveProgress;  // 状态栏中的保存进度
     QListWidget* curveList;
     QPushButton* btnAddCurve;
     QPushButton* btnDeleteCurve;
+    QProgressBar* loadProgress;
+    QPushButton* btnCancelLoad;
     
     // 右侧属性面板
     QWidget* rightPanel;
@@ -133,6 +217,7 @@ private:
     QPushButton* btnSelectCsv;
     QComboBox* cmbXColumn;
     QComboBox* cmbYColumn;
+    QCheckBox* chkFollowFile;
     QPushButton* btnCurveColor;
     QComboBox* cmbLineStyle;
     QDoubleSpinBox* spinLineWidth;
@@ -186,11 +271,26 @@ private:
     bool isDragging;
     QCPGraph* draggedGraph;
     int draggedPointIndex;
-    QStack<HistoryState> undoStack;
-    QStack<HistoryState> redoStack;
+    double dragStartValue;  // 被拖动点拖动前的Y值
+    EditHistory history;  // 撤销/重做记录（所有曲线共用）
+    EditJournal journal;  // 修改日志（崩溃后恢复）
+    QHash<QCPGraph*, RecoveredCurve> pendingRecovery;  // 等待加载完成后写回的恢复数据
+    QCPLayer* dragLayer;  // 独立缓冲的拖动层：拖动时只重绘这一层
+    QCPGraph* dragMarker;  // 拖动层上标出被拖动点的标记
     
     // 自动范围标志
     bool hasAutoRescaled;  // 是否已经自动调整过范围
+    
+    // 后台加载状态
+    QList<QSharedPointer<CurveLoadJob>> loadJobs;
+    QTimer* loadTimer;
+    
+    // 跟踪文件定时器
+    QTimer* followTimer;
+    
+    // 后台保存状态（同一时间只有一个保存任务）
+    QSharedPointer<CurveSaveJob> saveJob;
+    QTimer* saveTimer;
 };
 
 #endif // MAINWINDOW_H
@@ -1,4 +1,4 @@
-QT = core gui printsupport widgets
+QT = core gui printsupport widgets concurrent
 
 
 CONFIG += c++17
@@ -8,9 +8,20 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 TARGET = CSVCurveKit
 SOURCES += \
+        csvcache.cpp \
+        csvfile.cpp \
+        csvloader.cpp \
+        csvnumber.cpp \
+        csvscanner.cpp \
+        csvtable.cpp \
+        csvwriter.cpp \
+        edithistory.cpp \
+        editjournal.cpp \
         main.cpp \
         mainwindow.cpp \
-        qcustomplot.cpp
+        pointindex.cpp \
+        qcustomplot.cpp \
+        replotscheduler.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -18,5 +29,16 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    csvcache.h \
+    csvfile.h \
+    csvloader.h \
+    csvnumber.h \
+    csvscanner.h \
+    csvtable.h \
+    csvwriter.h \
+    edithistory.h \
+    editjournal.h \
     mainwindow.h \
-    qcustomplot.h
+    pointindex.h \
+    qcustomplot.h \
+    replotscheduler.h
@@ -0,0 +1,273 @@
+#include "pointindex.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// 每个桶中相邻数据点的个数
+const int kBucketSize = 32;
+
+// 坐标轴空间：对数轴取自然对数，线性轴不变；无法显示的点返回 false
+inline bool axisSpace(double coord, bool log, double& t)
+{
+    if (log) {
+        if (!(coord > 0))
+            return false;
+        t = std::log(coord);
+    } else {
+        t = coord;
+    }
+    return std::isfinite(t);
+}
+
+// 与 axisSpace 的判断相同，但不计算对数
+inline bool displayable(double coord, bool log)
+{
+    return std::isfinite(coord) && (!log || coord > 0);
+}
+
+// 坐标轴空间到像素的线性变换 pixel = scale * t + offset（由当前范围两端求出，反转的轴 scale < 0）
+bool pixelTransform(const QCPAxis* axis, double& scale, double& offset)
+{
+    const bool log = axis->scaleType() == QCPAxis::stLogarithmic;
+    const QCPRange range = axis->range();
+    double t0, t1;
+    if (!axisSpace(range.lower, log, t0) || !axisSpace(range.upper, log, t1) || t0 == t1)
+        return false;
+    const double p0 = axis->coordToPixel(range.lower);
+    const double p1 = axis->coordToPixel(range.upper);
+    scale = (p1 - p0) / (t1 - t0);
+    offset = p0 - scale * t0;
+    return true;
+}
+
+} // namespace
+
+struct PointIndex::Query {
+    QCPGraphDataContainer::const_iterator points;
+    int size;
+    bool log[2];
+    double scale[2];
+    double offset[2];
+    double pixel[2];  // 查询位置（像素）
+    double target[2];  // 查询位置（坐标轴空间）
+    bool clip;
+    double visibleMin[2];  // 可见范围（像素）
+    double visibleMax[2];
+    double bestDistance2;
+    int best;
+
+    // 包围盒到查询点的像素距离的平方（下界）
+    double lowerBound(const Box& box) const
+    {
+        if (box.min[0] > box.max[0])
+            return std::numeric_limits<double>::infinity();
+        double distance2 = 0;
+        for (int dim = 0; dim < 2; ++dim) {
+            double gap = 0;
+            if (target[dim] < box.min[dim])
+                gap = box.min[dim] - target[dim];
+            else if (target[dim] > box.max[dim])
+                gap = target[dim] - box.max[dim];
+            gap *= scale[dim];
+            distance2 += gap * gap;
+        }
+        return distance2;
+    }
+
+    void consider(int index)
+    {
+        const QCPGraphData& point = *(points + index);
+        double t[2];
+        if (!axisSpace(point.key, log[0], t[0]) || !axisSpace(point.value, log[1], t[1]))
+            return;
+        const double px = scale[0] * t[0] + offset[0];
+        const double py = scale[1] * t[1] + offset[1];
+        if (clip && (px < visibleMin[0] || px > visibleMax[0] || py < visibleMin[1] || py > visibleMax[1]))
+            return;
+        const double dx = px - pixel[0];
+        const double dy = py - pixel[1];
+        const double distance2 = dx * dx + dy * dy;
+        if (distance2 < bestDistance2) {
+            bestDistance2 = distance2;
+            best = index;
+        }
+    }
+};
+
+PointIndex::PointIndex()
+    : mLeafCount(0), mRevision(0), mSize(0), mLogKey(false), mLogValue(false), mBuilt(false)
+{
+}
+
+void PointIndex::clear()
+{
+    mNodes.clear();
+    mLeafCount = 0;
+    mBuilt = false;
+    mCached.valid = false;
+}
+
+void PointIndex::pointChanged(const QCPGraphDataContainer& data, int index)
+{
+    // 索引已过期时下次查询会整体重建，不必更新
+    if (!mBuilt || data.size() != mSize || data.revision() != mRevision + 1) {
+        mBuilt = false;
+        return;
+    }
+    mRevision = data.revision();
+    mCached.valid = false;
+    
+    int node = mLeafCount + index / kBucketSize;
+    mNodes[node] = bucketBox(data, index / kBucketSize);
+    for (node /= 2; node >= 1; node /= 2) {
+        const Box& left = mNodes[2 * node];
+        const Box& right = mNodes[2 * node + 1];
+        Box& box = mNodes[node];
+        for (int dim = 0; dim < 2; ++dim) {
+            box.min[dim] = qMin(left.min[dim], right.min[dim]);
+            box.max[dim] = qMax(left.max[dim], right.max[dim]);
+        }
+    }
+}
+
+int PointIndex::nearest(const QCPGraphDataContainer& data, const QCPAxis* keyAxis, const QCPAxis* valueAxis,
+                        const QPointF& pos, double maxDistance, double* distance, const QRectF& visibleRect)
+{
+    Query query;
+    query.points = data.constBegin();
+    query.size = data.size();
+    query.log[0] = keyAxis->scaleType() == QCPAxis::stLogarithmic;
+    query.log[1] = valueAxis->scaleType() == QCPAxis::stLogarithmic;
+    query.bestDistance2 = maxDistance * maxDistance;
+    query.best = -1;
+    if (data.isEmpty() || !pixelTransform(keyAxis, query.scale[0], query.offset[0])
+            || !pixelTransform(valueAxis, query.scale[1], query.offset[1]))
+        return -1;
+    
+    if (!mBuilt || data.revision() != mRevision || data.size() != mSize
+            || query.log[0] != mLogKey || query.log[1] != mLogValue) {
+        rebuild(data, query.log[0], query.log[1]);
+        mCached.valid = false;
+    }
+    
+    // 键轴竖直放置时键对应像素的Y坐标
+    const bool keyHorizontal = keyAxis->orientation() == Qt::Horizontal;
+    query.pixel[0] = keyHorizontal ? pos.x() : pos.y();
+    query.pixel[1] = keyHorizontal ? pos.y() : pos.x();
+    query.clip = !visibleRect.isNull();
+    query.visibleMin[0] = keyHorizontal ? visibleRect.left() : visibleRect.top();
+    query.visibleMax[0] = keyHorizontal ? visibleRect.right() : visibleRect.bottom();
+    query.visibleMin[1] = keyHorizontal ? visibleRect.top() : visibleRect.left();
+    query.visibleMax[1] = keyHorizontal ? visibleRect.bottom() : visibleRect.right();
+    
+    // 与上一次查询的位置和视图都相同
+    bool cached = mCached.valid && mCached.maxDistance == maxDistance && mCached.visibleRect == visibleRect;
+    for (int dim = 0; dim < 2 && cached; ++dim) {
+        cached = mCached.pixel[dim] == query.pixel[dim] && mCached.scale[dim] == query.scale[dim]
+                && mCached.offset[dim] == query.offset[dim];
+    }
+    if (cached) {
+        query.best = mCached.best;
+        query.bestDistance2 = mCached.bestDistance2;
+    } else {
+        for (int dim = 0; dim < 2; ++dim)
+            query.target[dim] = (query.pixel[dim] - query.offset[dim]) / query.scale[dim];
+        search(1, query);
+        
+        mCached.valid = true;
+        mCached.maxDistance = maxDistance;
+        mCached.visibleRect = visibleRect;
+        for (int dim = 0; dim < 2; ++dim) {
+            mCached.pixel[dim] = query.pixel[dim];
+            mCached.scale[dim] = query.scale[dim];
+            mCached.offset[dim] = query.offset[dim];
+        }
+        mCached.best = query.best;
+        mCached.bestDistance2 = query.bestDistance2;
+    }
+    
+    if (distance && query.best >= 0)
+        *distance = std::sqrt(query.bestDistance2);
+    return query.best;
+}
+
+void PointIndex::search(int node, Query& query) const
+{
+    if (node >= mLeafCount) {
+        // 桶：逐点比较
+        const int begin = (node - mLeafCount) * kBucketSize;
+        const int end = qMin(begin + kBucketSize, query.size);
+        for (int index = begin; index < end; ++index)
+            query.consider(index);
+        return;
+    }
+    
+    // 先搜包围盒更近的子节点，找到的点越近，能剪掉的节点越多
+    int first = 2 * node;
+    int second = 2 * node + 1;
+    double firstBound = query.lowerBound(mNodes[first]);
+    double secondBound = query.lowerBound(mNodes[second]);
+    if (secondBound < firstBound) {
+        std::swap(first, second);
+        std::swap(firstBound, secondBound);
+    }
+    if (firstBound < query.bestDistance2)
+        search(first, query);
+    if (secondBound < query.bestDistance2)
+        search(second, query);
+}
+
+PointIndex::Box PointIndex::bucketBox(const QCPGraphDataContainer& data, int bucket) const
+{
+    // 对数变换是单调的，先求原始坐标的范围再变换，每个桶只需计算几次对数
+    Box box;
+    const double inf = std::numeric_limits<double>::infinity();
+    double keyMin = inf, keyMax = -inf, valueMin = inf, valueMax = -inf;
+    const int begin = qMin(bucket * kBucketSize, data.size());
+    const int end = qMin(begin + kBucketSize, data.size());
+    for (auto it = data.constBegin() + begin; it != data.constBegin() + end; ++it) {
+        if (!displayable(it->key, mLogKey) || !displayable(it->value, mLogValue))
+            continue;
+        keyMin = qMin(keyMin, it->key);
+        keyMax = qMax(keyMax, it->key);
+        valueMin = qMin(valueMin, it->value);
+        valueMax = qMax(valueMax, it->value);
+    }
+    if (keyMin > keyMax) {
+        box.min[0] = box.min[1] = inf;
+        box.max[0] = box.max[1] = -inf;
+        return box;
+    }
+    axisSpace(keyMin, mLogKey, box.min[0]);
+    axisSpace(keyMax, mLogKey, box.max[0]);
+    axisSpace(valueMin, mLogValue, box.min[1]);
+    axisSpace(valueMax, mLogValue, box.max[1]);
+    return box;
+}
+
+void PointIndex::rebuild(const QCPGraphDataContainer& data, bool logKey, bool logValue)
+{
+    mLogKey = logKey;
+    mLogValue = logValue;
+    mSize = data.size();
+    mRevision = data.revision();
+    
+    const int bucketCount = (mSize + kBucketSize - 1) / kBucketSize;
+    mLeafCount = 1;
+    while (mLeafCount < bucketCount)
+        mLeafCount *= 2;
+    mNodes.resize(2 * mLeafCount);
+    for (int bucket = 0; bucket < mLeafCount; ++bucket)
+        mNodes[mLeafCount + bucket] = bucketBox(data, bucket);  // 超出数据的桶为空
+    for (int node = mLeafCount - 1; node >= 1; --node) {
+        const Box& left = mNodes[2 * node];
+        const Box& right = mNodes[2 * node + 1];
+        Box& box = mNodes[node];
+        for (int dim = 0; dim < 2; ++dim) {
+            box.min[dim] = qMin(left.min[dim], right.min[dim]);
+            box.max[dim] = qMax(left.max[dim], right.max[dim]);
+        }
+    }
+    mBuilt = true;
+}
@@ -0,0 +1,62 @@
+#ifndef POINTINDEX_H
+#define POINTINDEX_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+#include "qcustomplot.h"
+
+// 曲线数据点的空间索引，用于拉点模式下按像素距离查找最近的点
+// 数据已按键排序，每 kBucketSize 个相邻点为一个桶，桶之上是一棵完全二叉树，每个节点记录其下所有点的包围盒。
+// 包围盒在坐标轴空间中（对数轴取对数），像素坐标与之只差一个线性变换，所以平移、缩放和反转坐标轴都不需要重建；
+// 查询时按包围盒到查询点的像素距离剪枝。建立只需扫描一遍数据，单个点的值改变时只更新它所在的桶和上层节点。
+// 数据的其他改变或坐标轴类型改变后在下一次查询时重建。
+// 最近一次查询的结果按像素位置缓存，视图和数据都未变化时（如鼠标悬停在同一像素上）直接返回
+class PointIndex
+{
+public:
+    PointIndex();
+
+    // 返回与 pos 的像素距离小于 maxDistance 的最近点在 data 中的下标，没有时返回 -1；
+    // visibleRect 不为空时只考虑显示在其中的点（通常为坐标轴矩形）
+    int nearest(const QCPGraphDataContainer& data, const QCPAxis* keyAxis, const QCPAxis* valueAxis,
+                const QPointF& pos, double maxDistance, double* distance = nullptr,
+                const QRectF& visibleRect = QRectF());
+    // data 中第 index 个点的值被 QCPDataContainer::update 修改（键不变）之后调用，只更新受影响的节点
+    void pointChanged(const QCPGraphDataContainer& data, int index);
+    void clear();
+
+private:
+    struct Box {
+        double min[2];  // 坐标轴空间中的键、值范围，没有可显示的点时 min > max
+        double max[2];
+    };
+    struct Query;
+
+    void rebuild(const QCPGraphDataContainer& data, bool logKey, bool logValue);
+    Box bucketBox(const QCPGraphDataContainer& data, int bucket) const;
+    void search(int node, Query& query) const;
+
+    // 最近一次查询的参数和结果
+    struct CachedQuery {
+        bool valid = false;
+        double pixel[2];
+        double maxDistance;
+        QRectF visibleRect;
+        double scale[2];
+        double offset[2];
+        int best;
+        double bestDistance2;
+    };
+
+    QVector<Box> mNodes;  // 完全二叉树（根的下标为1），最后 mLeafCount 个节点为桶
+    int mLeafCount;  // 不小于桶数的2的幂
+    quint64 mRevision;
+    int mSize;
+    bool mLogKey;
+    bool mLogValue;
+    bool mBuilt;
+    CachedQuery mCached;
+};
+
+#endif // POINTINDEX_H
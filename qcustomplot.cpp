@@ -24,6 +24,13 @@
 ****************************************************************************/
 
 #include "qcustomplot.h"
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtCore/QDataStream>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define QCP_SSE2
+#  include <emmintrin.h>
+#endif
 //#include <GL/freeglut.h>
 
 /* including file 'src/vector2d.cpp'       */
@@ -9349,6 +9356,141 @@ double QCPAxis::coordToPixel(double value) const
   }
 }
 
+/*! \internal
+
+  Natural logarithm of a positive, normal (neither denormalized nor infinite) \a x, used by the
+  batch version of \ref QCPAxis::coordToPixel. With x = m*2^e and m in [sqrt(1/2), sqrt(2)), it
+  evaluates e*ln(2) + ln(m), where ln(m) = 2*atanh(s) with s = (m-1)/(m+1) is summed as odd power
+  series up to s^13. Since |s| < 0.172, the absolute error stays below 1e-12.
+*/
+static inline double qcpFastLn(double x)
+{
+  quint64 bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  double exponent = double(int(bits >> 52) - 1023);
+  bits = (bits & Q_UINT64_C(0x000FFFFFFFFFFFFF)) | Q_UINT64_C(0x3FF0000000000000);
+  double m;
+  std::memcpy(&m, &bits, sizeof(m));
+  if (m > M_SQRT2)
+  {
+    m *= 0.5;
+    exponent += 1.0;
+  }
+  const double s = (m-1.0)/(m+1.0);
+  const double z = s*s;
+  const double series = ((((((2.0/13*z + 2.0/11)*z + 2.0/9)*z + 2.0/7)*z + 2.0/5)*z + 2.0/3)*z + 2.0);
+  return exponent*M_LN2 + s*series;
+}
+
+#ifdef QCP_SSE2
+/*! \internal
+
+  Evaluates the scalar qcpFastLn for two values at once, with the same operations in the same
+  order, so both give identical results.
+*/
+static inline __m128d qcpFastLn(__m128d x)
+{
+  const __m128i bits = _mm_castpd_si128(x);
+  // the biased exponent is put into the low mantissa bits of 2^52, which makes it an exact double:
+  const __m128d twoPow52 = _mm_set1_pd(4503599627370496.0);
+  __m128d exponent = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits, 52), _mm_castpd_si128(twoPow52))),
+                                _mm_set1_pd(4503599627370496.0+1023.0));
+  __m128d m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                            _mm_set1_epi64x(0x3FF0000000000000LL)));
+  const __m128d halve = _mm_cmpgt_pd(m, _mm_set1_pd(M_SQRT2));
+  m = _mm_sub_pd(m, _mm_and_pd(halve, _mm_mul_pd(m, _mm_set1_pd(0.5))));
+  exponent = _mm_add_pd(exponent, _mm_and_pd(halve, _mm_set1_pd(1.0)));
+  const __m128d s = _mm_div_pd(_mm_sub_pd(m, _mm_set1_pd(1.0)), _mm_add_pd(m, _mm_set1_pd(1.0)));
+  const __m128d z = _mm_mul_pd(s, s);
+  __m128d series = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(2.0/13), z), _mm_set1_pd(2.0/11));
+  series = _mm_add_pd(_mm_mul_pd(series, z), _mm_set1_pd(2.0/9));
+  series = _mm_add_pd(_mm_mul_pd(series, z), _mm_set1_pd(2.0/7));
+  series = _mm_add_pd(_mm_mul_pd(series, z), _mm_set1_pd(2.0/5));
+  series = _mm_add_pd(_mm_mul_pd(series, z), _mm_set1_pd(2.0/3));
+  series = _mm_add_pd(_mm_mul_pd(series, z), _mm_set1_pd(2.0));
+  return _mm_add_pd(_mm_mul_pd(exponent, _mm_set1_pd(M_LN2)), _mm_mul_pd(s, series));
+}
+#endif
+
+/*! \overload
+
+  Transforms the \a count axis coordinates at \a values to pixel coordinates and writes them to \a
+  pixels. Consecutive coordinates are \a valueStride doubles apart, e.g. a stride of 2 reads the
+  keys (or values) directly from an array of \ref QCPGraphData.
+
+  The result is the same as calling \ref coordToPixel(double) for every value, but the scale type,
+  orientation and range direction are only evaluated once. Where SSE2 is available, two values are
+  transformed per instruction. Logarithmic axes use a fast approximation of the logarithm, whose
+  error is far below a pixel (the exact logarithm is used if the range is so narrow that this
+  wouldn't be the case). Values that are invalid for the logarithmic scale, infinite or NaN are
+  passed to \ref coordToPixel(double).
+*/
+void QCPAxis::coordToPixel(const double *values, double *pixels, int count, int valueStride) const
+{
+  // every transform has the form pixel = origin + (f(value)-f(base))*factor, with f being the identity or the logarithm:
+  const bool horizontal = orientation() == Qt::Horizontal;
+  const double length = horizontal ? mAxisRect->width() : -mAxisRect->height(); // vertical pixel coordinates grow downwards
+  const double origin = horizontal ? mAxisRect->left() : mAxisRect->bottom();
+  const double direction = mRangeReversed ? -1.0 : 1.0;
+  int i = 0;
+  if (mScaleType == stLinear)
+  {
+    const double base = mRangeReversed ? mRange.upper : mRange.lower;
+    const double factor = direction*length/mRange.size();
+#ifdef QCP_SSE2
+    const __m128d originVec = _mm_set1_pd(origin), baseVec = _mm_set1_pd(base), factorVec = _mm_set1_pd(factor);
+    for (; i+1 < count; i += 2)
+    {
+      const __m128d value = _mm_set_pd(values[(i+1)*valueStride], values[i*valueStride]);
+      _mm_storeu_pd(pixels+i, _mm_add_pd(originVec, _mm_mul_pd(_mm_sub_pd(value, baseVec), factorVec)));
+    }
+#endif
+    for (; i < count; ++i)
+      pixels[i] = origin + (values[i*valueStride]-base)*factor;
+  } else // mScaleType == stLogarithmic
+  {
+    const double sign = mRange.upper < 0 ? -1.0 : 1.0; // valid values have the same sign as the range
+    const double baseValue = sign*(mRangeReversed ? mRange.upper : mRange.lower);
+    const double base = qLn(baseValue);
+    const double factor = direction*length/qLn(mRange.upper/mRange.lower);
+    const double minValid = (std::numeric_limits<double>::min)();
+    const double maxValid = (std::numeric_limits<double>::max)();
+    if (qAbs(factor) > 1e9) // range so narrow that the approximation error could reach 1/1000 pixel
+    {
+      for (; i < count; ++i)
+      {
+        const double value = sign*values[i*valueStride];
+        pixels[i] = value >= minValid && value <= maxValid ? origin + qLn(value/baseValue)*factor : coordToPixel(values[i*valueStride]);
+      }
+      return;
+    }
+#ifdef QCP_SSE2
+    const __m128d originVec = _mm_set1_pd(origin), baseVec = _mm_set1_pd(base), factorVec = _mm_set1_pd(factor);
+    const __m128d signVec = _mm_set1_pd(sign), minVec = _mm_set1_pd(minValid), maxVec = _mm_set1_pd(maxValid);
+    for (; i+1 < count; i += 2)
+    {
+      const __m128d value = _mm_mul_pd(signVec, _mm_set_pd(values[(i+1)*valueStride], values[i*valueStride]));
+      if (_mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(value, minVec), _mm_cmple_pd(value, maxVec))) == 3)
+      {
+        _mm_storeu_pd(pixels+i, _mm_add_pd(originVec, _mm_mul_pd(_mm_sub_pd(qcpFastLn(value), baseVec), factorVec)));
+      } else // rare, handle both values with the scalar code below
+      {
+        for (int k=i; k<i+2; ++k)
+        {
+          const double scalarValue = sign*values[k*valueStride];
+          pixels[k] = scalarValue >= minValid && scalarValue <= maxValid ? origin + (qcpFastLn(scalarValue)-base)*factor : coordToPixel(values[k*valueStride]);
+        }
+      }
+    }
+#endif
+    for (; i < count; ++i)
+    {
+      const double value = sign*values[i*valueStride];
+      pixels[i] = value >= minValid && value <= maxValid ? origin + (qcpFastLn(value)-base)*factor : coordToPixel(values[i*valueStride]);
+    }
+  }
+}
+
 /*!
   Returns the part of the axis that is hit by \a pos (in pixels). The return value of this function
   is independent of the user-selectable parts defined with \ref setSelectableParts. Further, this
@@ -15144,10 +15286,20 @@ void QCustomPlot::replot(QCustomPlot::RefreshPriority refreshPriority)
   updateLayout();
   // draw all layered objects (grid, axes, plottables, items, legend,...) into their buffers:
   setupPaintBuffers();
+  if (mPlottingHints.testFlag(QCP::phParallelPreparation))
+    prepareGraphs();
   foreach (QCPLayer *layer, mLayers)
     layer->drawToPaintBuffer();
   foreach (QSharedPointer<QCPAbstractPaintBuffer> buffer, mPaintBuffers)
     buffer->setInvalidated(false);
+  foreach (QCPGraph *graph, mGraphs) // graphs that weren't drawn (e.g. on an invisible layer) must not keep their prepared data for a later layer replot
+  {
+    if (graph->mPrepared)
+    {
+      graph->mPrepared = false;
+      graph->mPreparedSegments.clear();
+    }
+  }
   
   if ((refreshPriority == rpRefreshHint && mPlottingHints.testFlag(QCP::phImmediateRefresh)) || refreshPriority==rpImmediateRefresh)
     repaint();
@@ -15874,6 +16026,46 @@ void QCustomPlot::setupPaintBuffers()
   }
 }
 
+/*! \internal
+
+  Computes the line and scatter pixel coordinates of all visible graphs on the global thread pool
+  (see \ref QCPGraph::prepareDraw), so the subsequent drawing of the layers only has to issue the
+  painter calls. This method is called in \ref replot after \ref setupPaintBuffers, if the
+  plotting hint \ref QCP::phParallelPreparation is set.
+
+  Graphs that share a data container are prepared one after another by the same task, because the
+  container may build cached data (e.g. its level of detail) lazily while it is read. If there is
+  only one such group, nothing is done here and the graph computes its coordinates while drawing,
+  as usual.
+*/
+void QCustomPlot::prepareGraphs()
+{
+  QHash<const QCPGraphDataContainer*, int> groupIndices;
+  QVector<QList<QCPGraph*> > groups;
+  foreach (QCPGraph *graph, mGraphs)
+  {
+    if (!graph->realVisibility() || (graph->lineStyle() == QCPGraph::lsNone && graph->scatterStyle().isNone()))
+      continue;
+    const QCPGraphDataContainer *container = graph->mDataContainer.data();
+    int index = groupIndices.value(container, -1);
+    if (index < 0)
+    {
+      index = groups.size();
+      groupIndices.insert(container, index);
+      groups.append(QList<QCPGraph*>());
+    }
+    groups[index].append(graph);
+  }
+  if (groups.size() < 2)
+    return;
+  
+  QtConcurrent::blockingMap(groups, [](QList<QCPGraph*> &group)
+  {
+    foreach (QCPGraph *graph, group)
+      graph->prepareDraw();
+  });
+}
+
 /*! \internal
 
   This method is used by \ref setupPaintBuffers when it needs to create new paint buffers.
@@ -20880,7 +21072,9 @@ QCPGraph::QCPGraph(QCPAxis *keyAxis, QCPAxis *valueAxis) :
   QCPAbstractPlottable1D<QCPGraphData>(keyAxis, valueAxis),
   mLineStyle{},
   mScatterSkip{},
-  mAdaptiveSampling{}
+  mAdaptiveSampling{},
+  mPrepared(false),
+  mScatterSprites(256*1024) // cost is the number of device pixels of a sprite
 {
   // special handling for QCPGraphs to maintain the simple graph interface:
   mParentPlot->registerGraph(this);
@@ -21135,12 +21329,16 @@ void QCPGraph::draw(QCPPainter *painter)
   QList<QCPDataRange> selectedSegments, unselectedSegments, allSegments;
   getDataSegments(selectedSegments, unselectedSegments);
   allSegments << unselectedSegments << selectedSegments;
+  const bool usePrepared = mPrepared && mPreparedSegments.size() == allSegments.size(); // coordinates were already computed by prepareDraw
   for (int i=0; i<allSegments.size(); ++i)
   {
     bool isSelectedSegment = i >= unselectedSegments.size();
     // get line pixel points appropriate to line style:
     QCPDataRange lineDataRange = isSelectedSegment ? allSegments.at(i) : allSegments.at(i).adjusted(-1, 1); // unselected segments extend lines to bordering selected data point (safe to exceed total data bounds in first/last segment, getLines takes care)
-    getLines(&lines, lineDataRange);
+    if (usePrepared)
+      lines.swap(mPreparedSegments[i].lines);
+    else
+      getLines(&lines, lineDataRange);
     
     // check data validity if flag set:
 #ifdef QCUSTOMPLOT_CHECK_DATA
@@ -21180,16 +21378,54 @@ void QCPGraph::draw(QCPPainter *painter)
       finalScatterStyle = mSelectionDecorator->getFinalScatterStyle(mScatterStyle);
     if (!finalScatterStyle.isNone())
     {
-      getScatters(&scatters, allSegments.at(i));
+      if (usePrepared)
+        scatters.swap(mPreparedSegments[i].scatters);
+      else
+        getScatters(&scatters, allSegments.at(i));
       drawScatterPlot(painter, scatters, finalScatterStyle);
     }
   }
+  mPrepared = false;
+  mPreparedSegments.clear();
   
   // draw other selection decoration that isn't just line/scatter pens and brushes:
   if (mSelectionDecorator)
     mSelectionDecorator->drawDecoration(painter, selection());
 }
 
+/*! \internal
+
+  Computes the line and scatter pixel coordinates of every data segment exactly like \ref draw
+  would, and stores them so the next call of \ref draw only paints them. This method doesn't touch
+  the painter or any other GUI resource and is called by \ref QCustomPlot::prepareGraphs from a
+  worker thread, while the GUI thread waits.
+*/
+void QCPGraph::prepareDraw()
+{
+  mPrepared = false;
+  mPreparedSegments.clear();
+  if (!mKeyAxis || !mValueAxis) return;
+  if (mKeyAxis.data()->range().size() <= 0 || mDataContainer->isEmpty()) return;
+  if (mLineStyle == lsNone && mScatterStyle.isNone()) return;
+  
+  QList<QCPDataRange> selectedSegments, unselectedSegments, allSegments;
+  getDataSegments(selectedSegments, unselectedSegments);
+  allSegments << unselectedSegments << selectedSegments;
+  mPreparedSegments.resize(allSegments.size());
+  for (int i=0; i<allSegments.size(); ++i)
+  {
+    bool isSelectedSegment = i >= unselectedSegments.size();
+    QCPDataRange lineDataRange = isSelectedSegment ? allSegments.at(i) : allSegments.at(i).adjusted(-1, 1);
+    getLines(&mPreparedSegments[i].lines, lineDataRange);
+    QCPScatterStyle finalScatterStyle = mScatterStyle;
+    if (isSelectedSegment && mSelectionDecorator)
+      finalScatterStyle = mSelectionDecorator->getFinalScatterStyle(mScatterStyle);
+    if (!finalScatterStyle.isNone())
+      getScatters(&mPreparedSegments[i].scatters, allSegments.at(i));
+  }
+  mPrepared = true;
+}
+
 /* inherits documentation from base class */
 void QCPGraph::drawLegendIcon(QCPPainter *painter, const QRectF &rect) const
 {
@@ -21308,14 +21544,16 @@ void QCPGraph::getScatters(QVector<QPointF> *scatters, const QCPDataRange &dataR
     std::reverse(data.begin(), data.end());
   
   scatters->resize(data.size());
+  QVector<double> keyPixels, valuePixels;
+  dataToPixels(data, &keyPixels, &valuePixels);
   if (keyAxis->orientation() == Qt::Vertical)
   {
     for (int i=0; i<data.size(); ++i)
     {
       if (!qIsNaN(data.at(i).value))
       {
-        (*scatters)[i].setX(valueAxis->coordToPixel(data.at(i).value));
-        (*scatters)[i].setY(keyAxis->coordToPixel(data.at(i).key));
+        (*scatters)[i].setX(valuePixels.at(i));
+        (*scatters)[i].setY(keyPixels.at(i));
       }
     }
   } else
@@ -21324,13 +21562,32 @@ void QCPGraph::getScatters(QVector<QPointF> *scatters, const QCPDataRange &dataR
     {
       if (!qIsNaN(data.at(i).value))
       {
-        (*scatters)[i].setX(keyAxis->coordToPixel(data.at(i).key));
-        (*scatters)[i].setY(valueAxis->coordToPixel(data.at(i).value));
+        (*scatters)[i].setX(keyPixels.at(i));
+        (*scatters)[i].setY(valuePixels.at(i));
       }
     }
   }
 }
 
+/*! \internal
+
+  Transforms the keys and values of \a data to pixel coordinates along the key and value axis,
+  respectively, using the batch version of \ref QCPAxis::coordToPixel. \a keyPixels and \a
+  valuePixels are resized to the size of \a data.
+
+  \see dataToLines, getScatters
+*/
+void QCPGraph::dataToPixels(const QVector<QCPGraphData> &data, QVector<double> *keyPixels, QVector<double> *valuePixels) const
+{
+  const int stride = int(sizeof(QCPGraphData)/sizeof(double));
+  keyPixels->resize(data.size());
+  valuePixels->resize(data.size());
+  if (data.isEmpty())
+    return;
+  mKeyAxis.data()->coordToPixel(&data.constData()->key, keyPixels->data(), data.size(), stride);
+  mValueAxis.data()->coordToPixel(&data.constData()->value, valuePixels->data(), data.size(), stride);
+}
+
 /*! \internal
 
   Takes raw data points in plot coordinates as \a data, and returns a vector containing pixel
@@ -21351,19 +21608,21 @@ QVector<QPointF> QCPGraph::dataToLines(const QVector<QCPGraphData> &data) const
   result.resize(data.size());
   
   // transform data points to pixels:
+  QVector<double> keyPixels, valuePixels;
+  dataToPixels(data, &keyPixels, &valuePixels);
   if (keyAxis->orientation() == Qt::Vertical)
   {
     for (int i=0; i<data.size(); ++i)
     {
-      result[i].setX(valueAxis->coordToPixel(data.at(i).value));
-      result[i].setY(keyAxis->coordToPixel(data.at(i).key));
+      result[i].setX(valuePixels.at(i));
+      result[i].setY(keyPixels.at(i));
     }
   } else // key axis is horizontal
   {
     for (int i=0; i<data.size(); ++i)
     {
-      result[i].setX(keyAxis->coordToPixel(data.at(i).key));
-      result[i].setY(valueAxis->coordToPixel(data.at(i).value));
+      result[i].setX(keyPixels.at(i));
+      result[i].setY(valuePixels.at(i));
     }
   }
   return result;
@@ -21389,27 +21648,29 @@ QVector<QPointF> QCPGraph::dataToStepLeftLines(const QVector<QCPGraphData> &data
   result.resize(data.size()*2);
   
   // calculate steps from data and transform to pixel coordinates:
+  QVector<double> keyPixels, valuePixels;
+  dataToPixels(data, &keyPixels, &valuePixels);
   if (keyAxis->orientation() == Qt::Vertical)
   {
-    double lastValue = valueAxis->coordToPixel(data.first().value);
+    double lastValue = valuePixels.first();
     for (int i=0; i<data.size(); ++i)
     {
-      const double key = keyAxis->coordToPixel(data.at(i).key);
+      const double key = keyPixels.at(i);
       result[i*2+0].setX(lastValue);
       result[i*2+0].setY(key);
-      lastValue = valueAxis->coordToPixel(data.at(i).value);
+      lastValue = valuePixels.at(i);
       result[i*2+1].setX(lastValue);
       result[i*2+1].setY(key);
     }
   } else // key axis is horizontal
   {
-    double lastValue = valueAxis->coordToPixel(data.first().value);
+    double lastValue = valuePixels.first();
     for (int i=0; i<data.size(); ++i)
     {
-      const double key = keyAxis->coordToPixel(data.at(i).key);
+      const double key = keyPixels.at(i);
       result[i*2+0].setX(key);
       result[i*2+0].setY(lastValue);
-      lastValue = valueAxis->coordToPixel(data.at(i).value);
+      lastValue = valuePixels.at(i);
       result[i*2+1].setX(key);
       result[i*2+1].setY(lastValue);
     }
@@ -21437,27 +21698,29 @@ QVector<QPointF> QCPGraph::dataToStepRightLines(const QVector<QCPGraphData> &dat
   result.resize(data.size()*2);
   
   // calculate steps from data and transform to pixel coordinates:
+  QVector<double> keyPixels, valuePixels;
+  dataToPixels(data, &keyPixels, &valuePixels);
   if (keyAxis->orientation() == Qt::Vertical)
   {
-    double lastKey = keyAxis->coordToPixel(data.first().key);
+    double lastKey = keyPixels.first();
     for (int i=0; i<data.size(); ++i)
     {
-      const double value = valueAxis->coordToPixel(data.at(i).value);
+      const double value = valuePixels.at(i);
       result[i*2+0].setX(value);
       result[i*2+0].setY(lastKey);
-      lastKey = keyAxis->coordToPixel(data.at(i).key);
+      lastKey = keyPixels.at(i);
       result[i*2+1].setX(value);
       result[i*2+1].setY(lastKey);
     }
   } else // key axis is horizontal
   {
-    double lastKey = keyAxis->coordToPixel(data.first().key);
+    double lastKey = keyPixels.first();
     for (int i=0; i<data.size(); ++i)
     {
-      const double value = valueAxis->coordToPixel(data.at(i).value);
+      const double value = valuePixels.at(i);
       result[i*2+0].setX(lastKey);
       result[i*2+0].setY(value);
-      lastKey = keyAxis->coordToPixel(data.at(i).key);
+      lastKey = keyPixels.at(i);
       result[i*2+1].setX(lastKey);
       result[i*2+1].setY(value);
     }
@@ -21485,19 +21748,21 @@ QVector<QPointF> QCPGraph::dataToStepCenterLines(const QVector<QCPGraphData> &da
   result.resize(data.size()*2);
   
   // calculate steps from data and transform to pixel coordinates:
+  QVector<double> keyPixels, valuePixels;
+  dataToPixels(data, &keyPixels, &valuePixels);
   if (keyAxis->orientation() == Qt::Vertical)
   {
-    double lastKey = keyAxis->coordToPixel(data.first().key);
-    double lastValue = valueAxis->coordToPixel(data.first().value);
+    double lastKey = keyPixels.first();
+    double lastValue = valuePixels.first();
     result[0].setX(lastValue);
     result[0].setY(lastKey);
     for (int i=1; i<data.size(); ++i)
     {
-      const double key = (keyAxis->coordToPixel(data.at(i).key)+lastKey)*0.5;
+      const double key = (keyPixels.at(i)+lastKey)*0.5;
       result[i*2-1].setX(lastValue);
       result[i*2-1].setY(key);
-      lastValue = valueAxis->coordToPixel(data.at(i).value);
-      lastKey = keyAxis->coordToPixel(data.at(i).key);
+      lastValue = valuePixels.at(i);
+      lastKey = keyPixels.at(i);
       result[i*2+0].setX(lastValue);
       result[i*2+0].setY(key);
     }
@@ -21505,17 +21770,17 @@ QVector<QPointF> QCPGraph::dataToStepCenterLines(const QVector<QCPGraphData> &da
     result[data.size()*2-1].setY(lastKey);
   } else // key axis is horizontal
   {
-    double lastKey = keyAxis->coordToPixel(data.first().key);
-    double lastValue = valueAxis->coordToPixel(data.first().value);
+    double lastKey = keyPixels.first();
+    double lastValue = valuePixels.first();
     result[0].setX(lastKey);
     result[0].setY(lastValue);
     for (int i=1; i<data.size(); ++i)
     {
-      const double key = (keyAxis->coordToPixel(data.at(i).key)+lastKey)*0.5;
+      const double key = (keyPixels.at(i)+lastKey)*0.5;
       result[i*2-1].setX(key);
       result[i*2-1].setY(lastValue);
-      lastValue = valueAxis->coordToPixel(data.at(i).value);
-      lastKey = keyAxis->coordToPixel(data.at(i).key);
+      lastValue = valuePixels.at(i);
+      lastKey = keyPixels.at(i);
       result[i*2+0].setX(key);
       result[i*2+0].setY(lastValue);
     }
@@ -21545,6 +21810,9 @@ QVector<QPointF> QCPGraph::dataToImpulseLines(const QVector<QCPGraphData> &data)
   result.resize(data.size()*2);
   
   // transform data points to pixels:
+  QVector<double> keyPixels, valuePixels;
+  dataToPixels(data, &keyPixels, &valuePixels);
+  const double zeroPixel = valueAxis->coordToPixel(0);
   if (keyAxis->orientation() == Qt::Vertical)
   {
     for (int i=0; i<data.size(); ++i)
@@ -21552,10 +21820,10 @@ QVector<QPointF> QCPGraph::dataToImpulseLines(const QVector<QCPGraphData> &data)
       const QCPGraphData &current = data.at(i);
       if (!qIsNaN(current.value))
       {
-        const double key = keyAxis->coordToPixel(current.key);
-        result[i*2+0].setX(valueAxis->coordToPixel(0));
+        const double key = keyPixels.at(i);
+        result[i*2+0].setX(zeroPixel);
         result[i*2+0].setY(key);
-        result[i*2+1].setX(valueAxis->coordToPixel(current.value));
+        result[i*2+1].setX(valuePixels.at(i));
         result[i*2+1].setY(key);
       } else
       {
@@ -21570,11 +21838,11 @@ QVector<QPointF> QCPGraph::dataToImpulseLines(const QVector<QCPGraphData> &data)
       const QCPGraphData &current = data.at(i);
       if (!qIsNaN(current.value))
       {
-        const double key = keyAxis->coordToPixel(data.at(i).key);
+        const double key = keyPixels.at(i);
         result[i*2+0].setX(key);
-        result[i*2+0].setY(valueAxis->coordToPixel(0));
+        result[i*2+0].setY(zeroPixel);
         result[i*2+1].setX(key);
-        result[i*2+1].setY(valueAxis->coordToPixel(data.at(i).value));
+        result[i*2+1].setY(valuePixels.at(i));
       } else
       {
         result[i*2+0] = QPointF(0, 0);
@@ -21639,11 +21907,136 @@ void QCPGraph::drawFill(QCPPainter *painter, QVector<QPointF> *lines) const
 void QCPGraph::drawScatterPlot(QCPPainter *painter, const QVector<QPointF> &scatters, const QCPScatterStyle &style) const
 {
   applyScattersAntialiasingHint(painter);
+  if (drawScatterSprites(painter, scatters, style))
+    return;
   style.applyTo(painter, mPen);
   foreach (const QPointF &scatter, scatters)
     style.drawShape(painter, scatter.x(), scatter.y());
 }
 
+/*!  \internal
+  
+  Draws the scatters at the pixel positions \a scatters by blitting a pre-rendered pixmap (sprite)
+  of the scatter \a style, instead of drawing the shape of every scatter with \ref
+  QCPScatterStyle::drawShape.
+  
+  The sprites are rendered at the device pixel ratio of the paint device, and every scatter is
+  snapped to the nearest half device pixel. For each of the four possible sub-pixel offsets there
+  is a separate sprite in which the shape is drawn at that offset, so the pixmap itself is always
+  placed at whole device pixels. Sprites are cached in \ref mScatterSprites with the style, pen,
+  device pixel ratio and antialiasing as key.
+  
+  For many scatters, an occupancy bitmap of the clip rect with one bit per device pixel and
+  sub-pixel offset is used to blit each sprite position only once. Dense point clouds, where many
+  scatters snap to the same position, thus take time proportional to the covered area rather than
+  to the number of scatters. Since a repeated blit would produce the very same pixels (apart from
+  accumulating the alpha of antialiased edges), the image doesn't change.
+  
+  Returns false without drawing anything if sprites can't be used (vectorized or non-caching
+  painters, scaled or rotated painters, and the \ref QCPScatterStyle::ssDot and \ref
+  QCPScatterStyle::ssPixmap shapes, which are drawn as cheaply as a sprite anyway). In that case
+  \ref drawScatterPlot draws the shapes one by one.
+*/
+bool QCPGraph::drawScatterSprites(QCPPainter *painter, const QVector<QPointF> &scatters, const QCPScatterStyle &style) const
+{
+  const int phases = 2; // sub-pixel offsets per device pixel and direction
+  if (style.shape() == QCPScatterStyle::ssNone || style.shape() == QCPScatterStyle::ssDot || style.shape() == QCPScatterStyle::ssPixmap)
+    return false;
+  if (painter->modes().testFlag(QCPPainter::pmVectorized) || painter->modes().testFlag(QCPPainter::pmNoCaching))
+    return false;
+  if (painter->transform().type() > QTransform::TxTranslate)
+    return false;
+  
+  double devicePixelRatio = 1.0;
+#ifdef QCP_DEVICEPIXELRATIO_SUPPORTED
+#  ifdef QCP_DEVICEPIXELRATIO_FLOAT
+  devicePixelRatio = painter->device()->devicePixelRatioF();
+#  else
+  devicePixelRatio = painter->device()->devicePixelRatio();
+#  endif
+#endif
+  
+  // size of the sprite, large enough for the shape, the pen and the sub-pixel offset:
+  const QPen pen = style.isPenDefined() ? style.pen() : mPen;
+  double radius = style.size()/2.0;
+  if (style.shape() == QCPScatterStyle::ssCustom)
+  {
+    const QRectF bounds = style.customPath().boundingRect();
+    radius = qMax(qMax(qAbs(bounds.left()), qAbs(bounds.right())), qMax(qAbs(bounds.top()), qAbs(bounds.bottom())))*style.size()/6.0;
+  }
+  const int half = qCeil((radius + qMax(qreal(1.0), pen.widthF()) + 1.0)*devicePixelRatio);
+  const int spriteSize = 2*half + 1;
+  
+  QByteArray key;
+  QDataStream keyStream(&key, QIODevice::WriteOnly);
+  keyStream << int(style.shape()) << style.size() << pen << style.brush() << style.customPath()
+            << devicePixelRatio << painter->antialiasing() << int(painter->modes());
+  QPixmap sprites[phases][phases]; // copies, so later inserts can't evict sprites that are still needed
+  for (int phaseX=0; phaseX<phases; ++phaseX)
+  {
+    for (int phaseY=0; phaseY<phases; ++phaseY)
+    {
+      const QByteArray phaseKey = key + char(phaseX) + char(phaseY);
+      QPixmap *sprite = mScatterSprites.object(phaseKey);
+      if (!sprite)
+      {
+        sprite = new QPixmap(spriteSize, spriteSize);
+#ifdef QCP_DEVICEPIXELRATIO_SUPPORTED
+        sprite->setDevicePixelRatio(devicePixelRatio);
+#endif
+        sprite->fill(Qt::transparent);
+        QCPPainter spritePainter(sprite);
+        spritePainter.setModes(painter->modes());
+        spritePainter.setAntialiasing(painter->antialiasing());
+        style.applyTo(&spritePainter, mPen);
+        // the shape center lies at half+phase/phases device pixels, taking the antialiasing shift of the painter into account:
+        const QPointF shift = spritePainter.transform().map(QPointF(0, 0));
+        style.drawShape(&spritePainter, (half+phaseX/double(phases))/devicePixelRatio-shift.x(), (half+phaseY/double(phases))/devicePixelRatio-shift.y());
+        spritePainter.end();
+        if (!mScatterSprites.insert(phaseKey, sprite, spriteSize*spriteSize))
+          return false; // sprite larger than the whole cache (and deleted by the cache)
+      }
+      sprites[phaseX][phaseY] = *sprite;
+    }
+  }
+  
+  const QPointF shift = painter->transform().map(QPointF(0, 0));
+  const bool deduplicate = scatters.size() >= 1024; // for fewer scatters, clearing the bitmap isn't worth it
+  QRect occupancyRect; // device pixels, large enough for every scatter whose sprite reaches into the clip rect
+  if (deduplicate)
+  {
+    const QRect clip = clipRect();
+    occupancyRect.setCoords(qFloor((clip.left()+shift.x())*devicePixelRatio)-half, qFloor((clip.top()+shift.y())*devicePixelRatio)-half,
+                            qCeil((clip.right()+1+shift.x())*devicePixelRatio)+half, qCeil((clip.bottom()+1+shift.y())*devicePixelRatio)+half);
+    mScatterOccupancy.fill(0, (occupancyRect.width()*occupancyRect.height()+1)/2); // four bits (sub-pixel offsets) per device pixel
+  }
+  foreach (const QPointF &scatter, scatters)
+  {
+    const double deviceX = (scatter.x()+shift.x())*devicePixelRatio;
+    const double deviceY = (scatter.y()+shift.y())*devicePixelRatio;
+    if (!qIsFinite(deviceX) || !qIsFinite(deviceY))
+      continue;
+    // snap to the nearest 1/phases device pixel, split into whole pixel and sub-pixel offset:
+    const double snappedX = std::floor(deviceX*phases+0.5);
+    const double snappedY = std::floor(deviceY*phases+0.5);
+    const double pixelX = std::floor(snappedX/phases);
+    const double pixelY = std::floor(snappedY/phases);
+    const int phaseX = int(snappedX-pixelX*phases);
+    const int phaseY = int(snappedY-pixelY*phases);
+    if (deduplicate && pixelX >= occupancyRect.left() && pixelX <= occupancyRect.right() && pixelY >= occupancyRect.top() && pixelY <= occupancyRect.bottom())
+    {
+      const int pixel = (int(pixelY)-occupancyRect.top())*occupancyRect.width() + int(pixelX)-occupancyRect.left();
+      const quint8 bit = quint8(1 << ((pixel & 1)*4 + phaseX*phases + phaseY));
+      quint8 &occupancy = mScatterOccupancy[pixel >> 1];
+      if (occupancy & bit)
+        continue;
+      occupancy |= bit;
+    }
+    painter->drawPixmap(QPointF((pixelX-half)/devicePixelRatio-shift.x(), (pixelY-half)/devicePixelRatio-shift.y()), sprites[phaseX][phaseY]);
+  }
+  return true;
+}
+
 /*!  \internal
   
   Draws lines between the points in \a lines, given in pixel coordinates.
@@ -21722,6 +22115,35 @@ void QCPGraph::getOptimizedLineData(QVector<QCPGraphData> *lineData, const QCPGr
     double lastIntervalEndKey = currentIntervalStartKey;
     double keyEpsilon = qAbs(currentIntervalStartKey-keyAxis->pixelToCoord(keyAxis->coordToPixel(currentIntervalStartKey)+1.0*reversedFactor)); // interval of one pixel on screen when mapped to plot key coordinates
     bool keyEpsilonVariable = keyAxis->scaleType() == QCPAxis::stLogarithmic; // indicates whether keyEpsilon needs to be updated after every interval (for log axes)
+    if (mDataContainer->lodEnabled())
+    {
+      // same clusters as below, but each pixel interval is found by binary search and its value span is
+      // taken from the container's levels of detail, so the cost scales with the number of pixel intervals:
+      const QCPGraphDataContainer::const_iterator dataBegin = mDataContainer->constBegin();
+      while (true)
+      {
+        QCPGraphDataContainer::const_iterator intervalEnd = std::lower_bound(it+1, end, QCPGraphData(currentIntervalStartKey+keyEpsilon, 0), qcpLessThanSortKey<QCPGraphData>);
+        if (intervalEnd-it >= 2) // pixel has multiple data points, consolidate them to a cluster
+        {
+          mDataContainer->lodValueBounds(int(it-dataBegin), int(intervalEnd-dataBegin), minValue, maxValue);
+          if (lastIntervalEndKey < currentIntervalStartKey-keyEpsilon) // last point is further away, so first point of this cluster must be at a real data point
+            lineData->append(QCPGraphData(currentIntervalStartKey+keyEpsilon*0.2, it->value));
+          lineData->append(QCPGraphData(currentIntervalStartKey+keyEpsilon*0.25, minValue));
+          lineData->append(QCPGraphData(currentIntervalStartKey+keyEpsilon*0.75, maxValue));
+          if (intervalEnd != end && intervalEnd->key > currentIntervalStartKey+keyEpsilon*2) // next pixel starts further away, so make sure the last point of the cluster is at a real data point
+            lineData->append(QCPGraphData(currentIntervalStartKey+keyEpsilon*0.8, (intervalEnd-1)->value));
+        } else
+          lineData->append(QCPGraphData(it->key, it->value));
+        if (intervalEnd == end)
+          break;
+        lastIntervalEndKey = (intervalEnd-1)->key;
+        it = intervalEnd;
+        currentIntervalStartKey = keyAxis->pixelToCoord(int(keyAxis->coordToPixel(it->key)+reversedRound));
+        if (keyEpsilonVariable)
+          keyEpsilon = qAbs(currentIntervalStartKey-keyAxis->pixelToCoord(keyAxis->coordToPixel(currentIntervalStartKey)+1.0*reversedFactor));
+      }
+      return;
+    }
     int intervalDataCount = 1;
     ++it; // advance iterator to second data point because adaptive sampling works in 1 point retrospect
     while (it != end)
@@ -268,6 +268,8 @@ enum PlottingHint { phNone              = 0x000 ///< <tt>0x000</tt> No hints are
                     ,phImmediateRefresh = 0x002 ///< <tt>0x002</tt> causes an immediate repaint() instead of a soft update() when QCustomPlot::replot() is called with parameter \ref QCustomPlot::rpRefreshHint.
                                                 ///<                This is set by default to prevent the plot from freezing on fast consecutive replots (e.g. user drags ranges with mouse).
                     ,phCacheLabels      = 0x004 ///< <tt>0x004</tt> axis (tick) labels will be cached as pixmaps, increasing replot performance.
+                    ,phParallelPreparation = 0x008 ///< <tt>0x008</tt> the pixel coordinates of the lines and scatters of all visible graphs are computed on a thread pool
+                                                   ///<                before the layers are drawn. Only the painting itself stays on the GUI thread. This speeds up replots with many large graphs.
                   };
 Q_DECLARE_FLAGS(PlottingHints, PlottingHint)
 
@@ -2315,6 +2317,7 @@ public:
   void rescale(bool onlyVisiblePlottables=false);
   double pixelToCoord(double value) const;
   double coordToPixel(double value) const;
+  void coordToPixel(const double *values, double *pixels, int count, int valueStride=1) const;
   SelectablePart getPartAt(const QPointF &pos) const;
   QList<QCPAbstractPlottable*> plottables() const;
   QList<QCPGraph*> graphs() const;
@@ -2622,9 +2625,12 @@ public:
   int size() const { return mData.size()-mPreallocSize; }
   bool isEmpty() const { return size() == 0; }
   bool autoSqueeze() const { return mAutoSqueeze; }
+  quint64 revision() const { return mRevision; }
+  bool lodEnabled() const { return mLodEnabled; }
   
   // setters:
   void setAutoSqueeze(bool enabled);
+  void setLodEnabled(bool enabled);
   
   // non-virtual methods:
   void set(const QCPDataContainer<DataType> &data);
@@ -2632,6 +2638,7 @@ public:
   void add(const QCPDataContainer<DataType> &data);
   void add(const QVector<DataType> &data, bool alreadySorted=false);
   void add(const DataType &data);
+  void update(int index, const DataType &data);
   void removeBefore(double sortKey);
   void removeAfter(double sortKey);
   void remove(double sortKeyFrom, double sortKeyTo);
@@ -2642,8 +2649,8 @@ public:
   
   const_iterator constBegin() const { return mData.constBegin()+mPreallocSize; }
   const_iterator constEnd() const { return mData.constEnd(); }
-  iterator begin() { return mData.begin()+mPreallocSize; }
-  iterator end() { return mData.end(); }
+  iterator begin() { invalidateRangeCache(); return mData.begin()+mPreallocSize; }
+  iterator end() { invalidateRangeCache(); return mData.end(); }
   const_iterator findBegin(double sortKey, bool expandedRange=true) const;
   const_iterator findEnd(double sortKey, bool expandedRange=true) const;
   const_iterator at(int index) const { return constBegin()+qBound(0, index, size()); }
@@ -2651,8 +2658,11 @@ public:
   QCPRange valueRange(bool &foundRange, QCP::SignDomain signDomain=QCP::sdBoth, const QCPRange &inKeyRange=QCPRange());
   QCPDataRange dataRange() const { return QCPDataRange(0, size()); }
   void limitIteratorsToDataRange(const_iterator &begin, const_iterator &end, const QCPDataRange &dataRange) const;
+  bool lodValueBounds(int beginIndex, int endIndex, double &minValue, double &maxValue) const;
   
 protected:
+  enum { lodBucketSize = 32 }; // number of data points summarized by one node of the lowest level of detail
+  
   // property members:
   bool mAutoSqueeze;
   
@@ -2660,10 +2670,24 @@ protected:
   QVector<DataType> mData;
   int mPreallocSize;
   int mPreallocIteration;
+  QCPRange mValueRangeCache[3]; // unrestricted valueRange results, indexed by QCP::SignDomain
+  bool mValueRangeFound[3];
+  bool mValueRangeValid[3];
+  quint64 mRevision;
+  bool mLodEnabled;
+  mutable QVector<QVector<QCPRange> > mLodLevels; // min/max of the main values, level i summarizes lodBucketSize*2^i data points per node
+  mutable quint64 mLodRevision; // revision the levels of detail were built for
+  mutable bool mLodValid;
   
   // non-virtual methods:
   void preallocateGrow(int minimumPreallocSize);
   void performAutoSqueeze();
+  void invalidateRangeCache() { mValueRangeValid[0] = mValueRangeValid[1] = mValueRangeValid[2] = false; ++mRevision; }
+  bool adjustCachedValueRange(int signDomain, const QCPRange &oldRange, const QCPRange &newRange);
+  void buildLod() const;
+  QCPRange lodBucketBounds(int bucket) const;
+  void updateLod(int firstIndex, int lastIndex);
+  static QCPRange lodUnite(const QCPRange &a, const QCPRange &b);
 };
 
 
@@ -2752,6 +2776,13 @@ protected:
   Returns whether this container holds no data points.
 */
 
+/*! \fn quint64 QCPDataContainer<DataType>::revision() const
+
+  Returns a counter that changes whenever the data may have been modified, including through \ref
+  update and obtaining non-const iterators (\ref begin, \ref end). Structures derived from the
+  data (e.g. search indices) can compare it to decide whether they need to be rebuilt.
+*/
+
 /*! \fn QCPDataContainer::const_iterator QCPDataContainer<DataType>::constBegin() const
   
   Returns a const iterator to the first data point in this container.
@@ -2769,6 +2800,9 @@ protected:
   You can manipulate the data points in-place through the non-const iterators, but great care must
   be taken when manipulating the sort key of a data point, see \ref sort, or the detailed
   description of this class.
+
+  Obtaining a non-const iterator discards the cached value ranges (see \ref valueRange), so the
+  next range query scans the data again. To change a single data point, \ref update is cheaper.
 */
 
 /*! \fn QCPDataContainer::iterator QCPDataContainer<DataType>::end() const
@@ -2778,6 +2812,8 @@ protected:
   You can manipulate the data points in-place through the non-const iterators, but great care must
   be taken when manipulating the sort key of a data point, see \ref sort, or the detailed
   description of this class.
+
+  Like \ref begin, this discards the cached value ranges.
 */
 
 /*! \fn QCPDataContainer::const_iterator QCPDataContainer<DataType>::at(int index) const
@@ -2806,8 +2842,13 @@ template <class DataType>
 QCPDataContainer<DataType>::QCPDataContainer() :
   mAutoSqueeze(true),
   mPreallocSize(0),
-  mPreallocIteration(0)
+  mPreallocIteration(0),
+  mRevision(0),
+  mLodEnabled(false),
+  mLodRevision(0),
+  mLodValid(false)
 {
+  invalidateRangeCache();
 }
 
 /*!
@@ -2829,6 +2870,30 @@ void QCPDataContainer<DataType>::setAutoSqueeze(bool enabled)
   }
 }
 
+/*!
+  Sets whether the container maintains a min/max pyramid of the main values (levels of detail).
+
+  The lowest level summarizes buckets of consecutive data points, every higher level summarizes
+  pairs of nodes of the level below. With it, the minimum and maximum main value of any index range
+  can be queried in logarithmic time with \ref lodValueBounds, which \ref QCPGraph uses for
+  adaptive sampling so that the cost of a replot scales with the pixel width of the plot instead of
+  the number of visible data points.
+
+  The pyramid is built lazily on the first query and patched incrementally by \ref update. Any
+  other modification of the data causes a rebuild on the next query. It needs about one \ref
+  QCPRange per 16 data points of memory. Disabled by default.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::setLodEnabled(bool enabled)
+{
+  mLodEnabled = enabled;
+  if (!enabled)
+  {
+    mLodLevels.clear();
+    mLodValid = false;
+  }
+}
+
 /*! \overload
   
   Replaces the current data in this container with the provided \a data.
@@ -2857,6 +2922,7 @@ void QCPDataContainer<DataType>::set(const QVector<DataType> &data, bool already
   mData = data;
   mPreallocSize = 0;
   mPreallocIteration = 0;
+  invalidateRangeCache();
   if (!alreadySorted)
     sort();
 }
@@ -2872,6 +2938,7 @@ void QCPDataContainer<DataType>::add(const QCPDataContainer<DataType> &data)
 {
   if (data.isEmpty())
     return;
+  invalidateRangeCache();
   
   const int n = data.size();
   const int oldSize = size();
@@ -2939,6 +3006,7 @@ void QCPDataContainer<DataType>::add(const QVector<DataType> &data, bool already
 template <class DataType>
 void QCPDataContainer<DataType>::add(const DataType &data)
 {
+  invalidateRangeCache();
   if (isEmpty() || !qcpLessThanSortKey<DataType>(data, *(constEnd()-1))) // quickly handle appends if new data key is greater or equal to existing ones
   {
     mData.append(data);
@@ -2955,6 +3023,57 @@ void QCPDataContainer<DataType>::add(const DataType &data)
   }
 }
 
+/*!
+  Replaces the data point at \a index with \a data in-place.
+
+  This is the fast path for editing a single point (e.g. dragging a value with the mouse): if the
+  sort key stays the same, no other data point is touched and the cached value ranges (see \ref
+  valueRange) are adjusted in constant time instead of being discarded, unless the old point was the
+  one defining a range bound. If the sort key changes, the point is moved to its new sorted
+  position, which costs time proportional to the distance it moves.
+
+  If \a index is out of bounds, this method does nothing.
+
+  \see add, begin
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::update(int index, const DataType &data)
+{
+  if (index < 0 || index >= size())
+    return;
+  ++mRevision;
+  
+  // access mData directly, non-const begin() would discard the cached ranges:
+  typename QVector<DataType>::iterator first = mData.begin()+mPreallocSize;
+  typename QVector<DataType>::iterator last = mData.end();
+  typename QVector<DataType>::iterator it = first+index;
+  const bool lodValid = mLodValid && mLodRevision+1 == mRevision;
+  const DataType oldData = *it;
+  *it = data;
+  int firstChanged = index, lastChanged = index;
+  if (qcpLessThanSortKey<DataType>(data, oldData)) // sort key decreased, rotate point down to its sorted position
+  {
+    typename QVector<DataType>::iterator position = std::upper_bound(first, it, data, qcpLessThanSortKey<DataType>);
+    std::rotate(position, it, it+1);
+    firstChanged = int(position-first);
+  } else if (qcpLessThanSortKey<DataType>(oldData, data)) // sort key increased, rotate point up to its sorted position
+  {
+    typename QVector<DataType>::iterator position = std::lower_bound(it+1, last, data, qcpLessThanSortKey<DataType>);
+    std::rotate(it, it+1, position);
+    lastChanged = int(position-first)-1;
+  }
+  if (lodValid)
+    updateLod(firstChanged, lastChanged);
+  
+  const QCPRange oldRange = oldData.valueRange();
+  const QCPRange newRange = data.valueRange();
+  for (int signDomain=0; signDomain<3; ++signDomain)
+  {
+    if (mValueRangeValid[signDomain] && !adjustCachedValueRange(signDomain, oldRange, newRange))
+      mValueRangeValid[signDomain] = false;
+  }
+}
+
 /*!
   Removes all data points with (sort-)keys smaller than or equal to \a sortKey.
   
@@ -3037,6 +3156,7 @@ void QCPDataContainer<DataType>::remove(double sortKey)
 template <class DataType>
 void QCPDataContainer<DataType>::clear()
 {
+  invalidateRangeCache();
   mData.clear();
   mPreallocIteration = 0;
   mPreallocSize = 0;
@@ -3278,6 +3398,10 @@ QCPRange QCPDataContainer<DataType>::keyRange(bool &foundRange, QCP::SignDomain
   relevant e.g. for logarithmic plots which can mathematically only display one sign domain at a
   time.
 
+  The result for an unrestricted \a inKeyRange is cached per \a signDomain until the data is
+  modified, so repeated calls (e.g. when rescaling axes during interaction) don't rescan all data
+  points. Single point changes through \ref update keep the cache valid where possible.
+
   \see keyRange
 */
 template <class DataType>
@@ -3288,8 +3412,13 @@ QCPRange QCPDataContainer<DataType>::valueRange(bool &foundRange, QCP::SignDomai
     foundRange = false;
     return QCPRange();
   }
-  QCPRange range;
   const bool restrictKeyRange = inKeyRange != QCPRange();
+  if (!restrictKeyRange && mValueRangeValid[signDomain])
+  {
+    foundRange = mValueRangeFound[signDomain];
+    return mValueRangeCache[signDomain];
+  }
+  QCPRange range;
   bool haveLower = false;
   bool haveUpper = false;
   QCPRange current;
@@ -3357,6 +3486,12 @@ QCPRange QCPDataContainer<DataType>::valueRange(bool &foundRange, QCP::SignDomai
   }
   
   foundRange = haveLower && haveUpper;
+  if (!restrictKeyRange)
+  {
+    mValueRangeCache[signDomain] = range;
+    mValueRangeFound[signDomain] = foundRange;
+    mValueRangeValid[signDomain] = true;
+  }
   return range;
 }
 
@@ -3377,6 +3512,211 @@ void QCPDataContainer<DataType>::limitIteratorsToDataRange(const_iterator &begin
   end = constBegin()+iteratorRange.end();
 }
 
+/*!
+  Returns the smallest and largest main value of the data points with indices from \a beginIndex
+  (inclusive) to \a endIndex (exclusive) via \a minValue and \a maxValue, using the levels of
+  detail (see \ref setLodEnabled): only the data points at the ends of the range that don't fill a
+  whole bucket are visited, the rest is covered by at most two nodes per level.
+
+  NaN main values are ignored like in the linear walk of \ref QCPGraph's adaptive sampling: the
+  bounds are seeded from the first data point of the range (so they are NaN if that point is NaN)
+  and every NaN comparison fails, which also skips nodes summarizing only NaN values.
+
+  Returns false (and leaves \a minValue and \a maxValue untouched) if levels of detail are disabled
+  or the range is empty.
+*/
+template <class DataType>
+bool QCPDataContainer<DataType>::lodValueBounds(int beginIndex, int endIndex, double &minValue, double &maxValue) const
+{
+  beginIndex = qMax(0, beginIndex);
+  endIndex = qMin(size(), endIndex);
+  if (!mLodEnabled || beginIndex >= endIndex)
+    return false;
+  if (!mLodValid || mLodRevision != mRevision)
+    buildLod();
+  
+  const const_iterator data = constBegin();
+  double lower = (data+beginIndex)->mainValue();
+  double upper = lower;
+  const auto scan = [&lower, &upper, data](int from, int to)
+  {
+    for (const_iterator it = data+from, itEnd = data+to; it != itEnd; ++it)
+    {
+      const double value = it->mainValue();
+      if (value < lower)
+        lower = value;
+      else if (value > upper)
+        upper = value;
+    }
+  };
+  int lo = (beginIndex+lodBucketSize-1)/lodBucketSize; // first bucket completely inside the range
+  int hi = endIndex/lodBucketSize; // bucket after the last one completely inside the range
+  if (lo >= hi)
+  {
+    scan(beginIndex, endIndex);
+  } else
+  {
+    scan(beginIndex, lo*lodBucketSize);
+    scan(hi*lodBucketSize, endIndex);
+    for (int level=0; lo < hi; ++level)
+    {
+      const QVector<QCPRange> &nodes = mLodLevels.at(level);
+      if (lo & 1)
+      {
+        const QCPRange &node = nodes.at(lo++);
+        if (node.lower < lower) lower = node.lower;
+        if (node.upper > upper) upper = node.upper;
+      }
+      if (hi & 1)
+      {
+        const QCPRange &node = nodes.at(--hi);
+        if (node.lower < lower) lower = node.lower;
+        if (node.upper > upper) upper = node.upper;
+      }
+      lo /= 2;
+      hi /= 2;
+    }
+  }
+  minValue = lower;
+  maxValue = upper;
+  return true;
+}
+
+/*! \internal
+
+  Adjusts the cached value range of \a signDomain after a single data point spanning \a oldRange
+  was replaced by one spanning \a newRange. Returns false if the cache can't be kept, i.e. the old
+  point may have defined a bound that the new point doesn't reach anymore, so a full scan is needed.
+*/
+template <class DataType>
+bool QCPDataContainer<DataType>::adjustCachedValueRange(int signDomain, const QCPRange &oldRange, const QCPRange &newRange)
+{
+  if (!mValueRangeFound[signDomain]) // the new point might create a range where there was none
+    return false;
+  
+  const auto counts = [signDomain](double value) // same filtering as in valueRange
+  {
+    if (qIsNaN(value) || !std::isfinite(value))
+      return false;
+    if (signDomain == QCP::sdNegative)
+      return value < 0;
+    if (signDomain == QCP::sdPositive)
+      return value > 0;
+    return true;
+  };
+  QCPRange &range = mValueRangeCache[signDomain];
+  if (counts(newRange.lower) && newRange.lower <= range.lower)
+    range.lower = newRange.lower;
+  else if (counts(oldRange.lower) && oldRange.lower <= range.lower)
+    return false;
+  if (counts(newRange.upper) && newRange.upper >= range.upper)
+    range.upper = newRange.upper;
+  else if (counts(oldRange.upper) && oldRange.upper >= range.upper)
+    return false;
+  return true;
+}
+
+/*! \internal
+
+  Returns the smallest (\a lower) and largest (\a upper) main value of the data points in \a
+  bucket of the lowest level of detail. NaN values are skipped; if the bucket contains only NaN
+  values, both bounds are NaN (an empty node, see \ref lodUnite).
+*/
+template <class DataType>
+QCPRange QCPDataContainer<DataType>::lodBucketBounds(int bucket) const
+{
+  const_iterator it = constBegin()+bucket*lodBucketSize;
+  const const_iterator itEnd = constBegin()+qMin(size(), (bucket+1)*lodBucketSize);
+  while (it != itEnd && qIsNaN(it->mainValue()))
+    ++it;
+  QCPRange bounds;
+  bounds.lower = bounds.upper = it != itEnd ? it->mainValue() : qQNaN();
+  for (; it != itEnd; ++it)
+  {
+    const double value = it->mainValue(); // NaN fails both comparisons
+    if (value < bounds.lower)
+      bounds.lower = value;
+    else if (value > bounds.upper)
+      bounds.upper = value;
+  }
+  return bounds;
+}
+
+/*! \internal
+
+  Returns the union of the nodes \a a and \a b of one level of detail. A node with NaN bounds
+  summarizes only NaN values and doesn't contribute.
+*/
+template <class DataType>
+QCPRange QCPDataContainer<DataType>::lodUnite(const QCPRange &a, const QCPRange &b)
+{
+  if (qIsNaN(a.lower))
+    return b;
+  QCPRange result = a;
+  if (b.lower < result.lower) // false if b is empty
+    result.lower = b.lower;
+  if (b.upper > result.upper)
+    result.upper = b.upper;
+  return result;
+}
+
+/*! \internal
+
+  Rebuilds all levels of detail from the current data in one pass over the data points.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::buildLod() const
+{
+  mLodLevels.clear();
+  int count = (size()+lodBucketSize-1)/lodBucketSize;
+  if (count > 0)
+  {
+    QVector<QCPRange> buckets(count);
+    for (int i=0; i<count; ++i)
+      buckets[i] = lodBucketBounds(i);
+    mLodLevels.append(buckets);
+  }
+  while (count > 1)
+  {
+    const QVector<QCPRange> below = mLodLevels.last(); // implicitly shared, no copy
+    count = (count+1)/2;
+    QVector<QCPRange> nodes(count);
+    for (int i=0; i<count; ++i)
+      nodes[i] = 2*i+1 < below.size() ? lodUnite(below.at(2*i), below.at(2*i+1)) : below.at(2*i);
+    mLodLevels.append(nodes);
+  }
+  mLodRevision = mRevision;
+  mLodValid = true;
+}
+
+/*! \internal
+
+  Patches the levels of detail after the data points with indices \a firstIndex to \a lastIndex
+  (inclusive) were changed in place by \ref update. Only the buckets containing them and the nodes
+  above those are recomputed.
+*/
+template <class DataType>
+void QCPDataContainer<DataType>::updateLod(int firstIndex, int lastIndex)
+{
+  if (mLodLevels.isEmpty())
+    return;
+  int lo = firstIndex/lodBucketSize;
+  int hi = lastIndex/lodBucketSize;
+  QVector<QCPRange> &buckets = mLodLevels[0];
+  for (int i=lo; i<=hi; ++i)
+    buckets[i] = lodBucketBounds(i);
+  for (int level=1; level<mLodLevels.size(); ++level)
+  {
+    const QVector<QCPRange> &below = mLodLevels.at(level-1);
+    QVector<QCPRange> &nodes = mLodLevels[level];
+    lo /= 2;
+    hi /= 2;
+    for (int i=lo; i<=hi; ++i)
+      nodes[i] = 2*i+1 < below.size() ? lodUnite(below.at(2*i), below.at(2*i+1)) : below.at(2*i);
+  }
+  mLodRevision = mRevision;
+}
+
 /*! \internal
   
   Increases the preallocation pool to have a size of at least \a minimumPreallocSize. Depending on
@@ -4040,6 +4380,7 @@ protected:
   QList<QCPLayerable*> layerableListAt(const QPointF &pos, bool onlySelectable, QList<QVariant> *selectionDetails=nullptr) const;
   void drawBackground(QCPPainter *painter);
   void setupPaintBuffers();
+  void prepareGraphs();
   QCPAbstractPaintBuffer *createPaintBuffer();
   bool hasInvalidatedPaintBuffers();
   bool setupOpenGl();
@@ -5554,6 +5895,13 @@ protected:
   QPointer<QCPGraph> mChannelFillGraph;
   bool mAdaptiveSampling;
   
+  // pixel coordinates computed ahead of draw by QCustomPlot::prepareGraphs:
+  struct PreparedSegment { QVector<QPointF> lines, scatters; };
+  QVector<PreparedSegment> mPreparedSegments;
+  bool mPrepared;
+  mutable QCache<QByteArray, QPixmap> mScatterSprites; // pre-rendered scatters, see drawScatterSprites
+  mutable QVector<quint8> mScatterOccupancy; // sprite positions already drawn, see drawScatterSprites
+  
   // reimplemented virtual methods:
   virtual void draw(QCPPainter *painter) Q_DECL_OVERRIDE;
   virtual void drawLegendIcon(QCPPainter *painter, const QRectF &rect) const Q_DECL_OVERRIDE;
@@ -5571,6 +5919,9 @@ protected:
   void getVisibleDataBounds(QCPGraphDataContainer::const_iterator &begin, QCPGraphDataContainer::const_iterator &end, const QCPDataRange &rangeRestriction) const;
   void getLines(QVector<QPointF> *lines, const QCPDataRange &dataRange) const;
   void getScatters(QVector<QPointF> *scatters, const QCPDataRange &dataRange) const;
+  void prepareDraw();
+  bool drawScatterSprites(QCPPainter *painter, const QVector<QPointF> &scatters, const QCPScatterStyle &style) const;
+  void dataToPixels(const QVector<QCPGraphData> &data, QVector<double> *keyPixels, QVector<double> *valuePixels) const;
   QVector<QPointF> dataToLines(const QVector<QCPGraphData> &data) const;
   QVector<QPointF> dataToStepLeftLines(const QVector<QCPGraphData> &data) const;
   QVector<QPointF> dataToStepRightLines(const QVector<QCPGraphData> &data) const;
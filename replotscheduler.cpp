@@ -0,0 +1,81 @@
+#include "replotscheduler.h"
+#include <QGuiApplication>
+#include <QScreen>
+
+ReplotScheduler::ReplotScheduler(QCustomPlot* plot, QObject* parent)
+    : QObject(parent), mPlot(plot), mFrameInterval(1000.0 / 60), mFramesPerSecond(0), mFrameCount(0),
+      mFullReplot(false)
+{
+    // 按主屏幕的刷新率限速，取不到时按60Hz
+    QScreen* screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 1)
+        mFrameInterval = 1000.0 / screen->refreshRate();
+    
+    mTimer.setSingleShot(true);
+    mTimer.setTimerType(Qt::PreciseTimer);
+    connect(&mTimer, &QTimer::timeout, this, &ReplotScheduler::render);
+}
+
+void ReplotScheduler::request()
+{
+    mFullReplot = true;
+    mDirtyLayers.clear();
+    schedule();
+}
+
+void ReplotScheduler::request(QCPLayer* layer)
+{
+    if (!layer || layer->mode() != QCPLayer::lmBuffered) {
+        request();
+        return;
+    }
+    if (!mFullReplot)
+        mDirtyLayers.insert(layer);
+    schedule();
+}
+
+void ReplotScheduler::schedule()
+{
+    if (mTimer.isActive())
+        return;  // 已在等待下一帧，本次请求并入其中
+    
+    // 距上一帧不足一个帧间隔时等到下一帧，否则在事件循环的下一轮渲染
+    int delay = 0;
+    if (mLastFrame.isValid())
+        delay = qMax(0, qRound(mFrameInterval - mLastFrame.elapsed()));
+    mTimer.start(delay);
+}
+
+void ReplotScheduler::render()
+{
+    // 空闲超过一秒后重新开始统计帧率，只反映连续交互期间的帧率
+    if (mLastFrame.isValid() && mLastFrame.elapsed() > 1000) {
+        mRateWindow.invalidate();
+        mFrameCount = 0;
+    }
+    mLastFrame.start();
+    if (mFullReplot) {
+        mPlot->replot();
+    } else {
+        // 只重绘变脏的缓冲层，其他层的缓冲直接合成（忽略期间已被删除的层）
+        for (int i = 0; i < mPlot->layerCount(); ++i) {
+            QCPLayer* layer = mPlot->layer(i);
+            if (mDirtyLayers.contains(layer))
+                layer->replot();
+        }
+    }
+    mFullReplot = false;
+    mDirtyLayers.clear();
+    
+    // 每秒统计一次实际帧率
+    if (!mRateWindow.isValid())
+        mRateWindow.start();
+    ++mFrameCount;
+    qint64 elapsed = mRateWindow.elapsed();
+    if (elapsed >= 1000) {
+        mFramesPerSecond = mFrameCount * 1000.0 / elapsed;
+        mFrameCount = 0;
+        mRateWindow.start();
+        emit frameRateChanged(mFramesPerSecond);
+    }
+}
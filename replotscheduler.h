@@ -0,0 +1,48 @@
+#ifndef REPLOTSCHEDULER_H
+#define REPLOTSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include "qcustomplot.h"
+
+// 合并界面触发的重绘请求：每个显示帧最多渲染一次（与 rpQueuedReplot 一样推迟到事件循环中执行，
+// 并按屏幕刷新率限速）。只有缓冲层变脏时只重绘这些层，否则完整重绘
+class ReplotScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReplotScheduler(QCustomPlot* plot, QObject* parent = nullptr);
+
+    // 请求完整重绘
+    void request();
+    // 只有 layer 的内容变化（须为 lmBuffered 模式的层，否则按完整重绘处理）
+    void request(QCPLayer* layer);
+
+    bool isPending() const { return mTimer.isActive(); }
+    double frameInterval() const { return mFrameInterval; }  // 毫秒
+    double framesPerSecond() const { return mFramesPerSecond; }  // 最近一秒内实际渲染的帧数
+
+signals:
+    void frameRateChanged(double framesPerSecond);
+
+private slots:
+    void render();
+
+private:
+    void schedule();
+
+    QCustomPlot* mPlot;
+    QTimer mTimer;
+    QElapsedTimer mLastFrame;  // 上一帧的渲染时刻
+    QElapsedTimer mRateWindow;  // 帧率统计窗口
+    double mFrameInterval;
+    double mFramesPerSecond;
+    int mFrameCount;
+    bool mFullReplot;
+    QSet<QCPLayer*> mDirtyLayers;
+};
+
+#endif // REPLOTSCHEDULER_H